@@ -0,0 +1,206 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include <chartgen_kernels.h>
+
+// Measures the throughput of the element-wise kernels against the plain loops
+// they replaced, in millions of data points per second.
+
+////////////////////////////////////////////////////////////////////////////////
+
+const size_t N = size_t( 1 ) << 22;
+const int reps = 10;
+
+volatile double sink;
+
+// Best time of reps runs in seconds.
+template< typename F >
+double best_of( F f )
+{
+  double best = 1e9;
+  for ( int r = 0; r < reps; r++ ) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    auto t1 = std::chrono::steady_clock::now();
+    best =
+      std::min( best, std::chrono::duration< double >( t1 - t0 ).count() );
+  }
+  return best;
+}
+
+void report( const char* name, double t_loop, double t_kernel )
+{
+  printf(
+    "%-22s %10.0f %10.0f %6.1fx\n",
+    name, N / t_loop / 1e6, N / t_kernel / 1e6, t_loop / t_kernel
+  );
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+void loop_min_max( const std::vector< T >& v, double& min, double& max )
+{
+  bool first = true;
+  for ( size_t i = 0; i < v.size(); i++ ) {
+    double x = v[ i ];
+    if ( first || x < min ) min = x;
+    if ( first || x > max ) max = x;
+    first = false;
+  }
+}
+
+template< typename T >
+void loop_map_to_cells(
+  const std::vector< T >& v,
+  bool log, double min, double max, int64_t cells, int64_t* out
+)
+{
+  for ( size_t i = 0; i < v.size(); i++ ) {
+    double x = log ? std::log10( double( v[ i ] ) ) : v[ i ];
+    int64_t c = (x - min) / (max - min) * cells;
+    out[ i ] = std::min( c, cells - 1 );
+  }
+}
+
+template< typename T >
+void loop_clip_codes(
+  const std::vector< T >& v,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+)
+{
+  for ( size_t i = 0; i < v.size(); i++ ) {
+    if ( v[ i ] < lo ) codes[ i ] |= below;
+    if ( v[ i ] > hi ) codes[ i ] |= above;
+  }
+}
+
+template< typename T >
+void loop_stack_values( const std::vector< T >& v, double* sum )
+{
+  for ( size_t i = 0; i < v.size(); i++ ) sum[ i ] = sum[ i ] + v[ i ];
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+void run( const char* type )
+{
+  std::mt19937_64 rng( 1 );
+  std::uniform_real_distribution< double > dist( 1.0, 1000.0 );
+  std::vector< T > v( N );
+  for ( auto& x : v ) x = dist( rng );
+  std::vector< int64_t > cells( N );
+  std::vector< uint8_t > codes( N );
+  std::vector< double > sum( N );
+
+  printf( "\n%s values, %zu points\n", type, N );
+  printf( "%-22s %10s %10s %7s\n", "Mpt/s", "loop", "kernel", "speedup" );
+
+  double min = 0, max = 0;
+  report(
+    "min_max",
+    best_of( [&]() { loop_min_max( v, min, max ); sink = min + max; } ),
+    best_of(
+      [&]() { chartgen::min_max( v.data(), N, min, max ); sink = min + max; }
+    )
+  );
+
+  report(
+    "map_to_cells",
+    best_of(
+      [&]()
+      {
+        loop_map_to_cells( v, false, 1.0, 1000.0, 1000, cells.data() );
+        sink = cells[ N / 2 ];
+      }
+    ),
+    best_of(
+      [&]()
+      {
+        chartgen::map_to_cells(
+          v.data(), N, false, 1.0, 1000.0, 1000, cells.data()
+        );
+        sink = cells[ N / 2 ];
+      }
+    )
+  );
+
+  report(
+    "map_to_cells (log)",
+    best_of(
+      [&]()
+      {
+        loop_map_to_cells( v, true, 0.0, 3.0, 1000, cells.data() );
+        sink = cells[ N / 2 ];
+      }
+    ),
+    best_of(
+      [&]()
+      {
+        chartgen::map_to_cells(
+          v.data(), N, true, 0.0, 3.0, 1000, cells.data()
+        );
+        sink = cells[ N / 2 ];
+      }
+    )
+  );
+
+  report(
+    "clip_codes",
+    best_of(
+      [&]()
+      {
+        loop_clip_codes( v, 250.0, 750.0, 1, 2, codes.data() );
+        sink = codes[ N / 2 ];
+      }
+    ),
+    best_of(
+      [&]()
+      {
+        chartgen::clip_codes( v.data(), N, 250.0, 750.0, 1, 2, codes.data() );
+        sink = codes[ N / 2 ];
+      }
+    )
+  );
+
+  report(
+    "stack_values",
+    best_of(
+      [&]() { loop_stack_values( v, sum.data() ); sink = sum[ N / 2 ]; }
+    ),
+    best_of(
+      [&]()
+      {
+        chartgen::stack_values( v.data(), N, sum.data() );
+        sink = sum[ N / 2 ];
+      }
+    )
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main( void )
+{
+  run< double >( "Double" );
+  run< float >( "Float" );
+  return 0;
+}
@@ -0,0 +1,69 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <chartgen_context.h>
+
+// Measures the creation of a chart with many small series, as the parse and
+// the build of the chart in milliseconds.
+
+////////////////////////////////////////////////////////////////////////////////
+
+const int series_count = 10000;
+
+double ms_since( std::chrono::steady_clock::time_point t0 )
+{
+  return
+    std::chrono::duration< double, std::milli >(
+      std::chrono::steady_clock::now() - t0
+    ).count();
+}
+
+void run( int points )
+{
+  std::string in = "Series.Type: XY\n";
+  for ( int s = 0; s < series_count; s++ ) {
+    in += "Series.New: S" + std::to_string( s ) + "\n";
+    if ( points == 0 ) continue;
+    in += "Series.Data:\n";
+    for ( int i = 0; i < points; i++ ) {
+      in += std::to_string( i ) + " " + std::to_string( s + i ) + "\n";
+    }
+  }
+
+  chartgen::Context context;
+  auto t0 = std::chrono::steady_clock::now();
+  context.AddText( "bench", in );
+  context.Parse();
+  double t_parse = ms_since( t0 );
+  t0 = std::chrono::steady_clock::now();
+  std::string out = context.Build();
+  double t_build = ms_since( t0 );
+
+  printf(
+    "%6d series of %2d points: parse %8.1f ms, build %8.1f ms\n",
+    series_count, points, t_parse, t_build
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+int main( void )
+{
+  run( 0 );
+  run( 30 );
+  return 0;
+}
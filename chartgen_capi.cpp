@@ -0,0 +1,233 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <cmath>
+#include <chartgen_capi.h>
+#include <chartgen_context.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct cg_series {
+  cg_context*           ctx;
+  chartgen::SeriesData* sd;
+};
+
+struct cg_context {
+  chartgen::Context context;
+  std::deque< cg_series > series;
+  std::string error;
+  std::string output;
+  bool built = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Run the given function, turning any exception into an error message as they
+// cannot propagate through the C interface. If even the message cannot be set
+// for lack of memory, the message is left empty.
+template< typename F >
+static int guard( cg_context* ctx, F f )
+{
+  try {
+    try {
+      f();
+    } catch ( const chartgen::Error& e ) {
+      ctx->error = e.what();
+      return -1;
+    } catch ( const std::exception& e ) {
+      ctx->error = std::string( "*** ERROR: " ) + e.what();
+      return -1;
+    }
+  } catch ( ... ) {
+    ctx->error.clear();
+    return -1;
+  }
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+cg_context_t* cg_create( void )
+{
+  try {
+    return new cg_context;
+  } catch ( ... ) {
+    return nullptr;
+  }
+}
+
+void cg_destroy( cg_context_t* ctx )
+{
+  delete ctx;
+}
+
+const char* cg_error( const cg_context_t* ctx )
+{
+  return ctx->error.c_str();
+}
+
+//------------------------------------------------------------------------------
+
+void cg_enable_html( cg_context_t* ctx, int enable )
+{
+  ctx->context.EnableHTML( enable != 0 );
+}
+
+void cg_set_max_bytes( cg_context_t* ctx, uint64_t n )
+{
+  ctx->context.SetMaxBytes( n );
+}
+
+void cg_set_max_elements( cg_context_t* ctx, uint64_t n )
+{
+  ctx->context.SetMaxElements( n );
+}
+
+void cg_set_target_width( cg_context_t* ctx, uint64_t n )
+{
+  ctx->context.SetTargetWidth( n );
+}
+
+void cg_set_deadline( cg_context_t* ctx, uint64_t ms )
+{
+  ctx->context.SetDeadline( ms );
+}
+
+//------------------------------------------------------------------------------
+
+int cg_add_text( cg_context_t* ctx, const char* name, const char* text )
+{
+  return guard( ctx, [&]() { ctx->context.AddText( name, text ); } );
+}
+
+int cg_add_file( cg_context_t* ctx, const char* file_name )
+{
+  return guard( ctx, [&]() { ctx->context.AddFile( file_name ); } );
+}
+
+int cg_parse( cg_context_t* ctx )
+{
+  return guard(
+    ctx,
+    [&]()
+    {
+      ctx->context.Parse();
+      size_t n = ctx->context.SeriesCount();
+      for ( size_t i = ctx->series.size(); i < n; i++ ) {
+        ctx->series.push_back( { ctx, ctx->context.GetSeries( i ) } );
+      }
+    }
+  );
+}
+
+//------------------------------------------------------------------------------
+
+size_t cg_series_count( cg_context_t* ctx )
+{
+  return ctx->built ? 0 : ctx->series.size();
+}
+
+cg_series_t* cg_get_series( cg_context_t* ctx, size_t idx )
+{
+  cg_series_t* series = nullptr;
+  guard(
+    ctx,
+    [&]()
+    {
+      if ( ctx->built || idx >= ctx->series.size() ) {
+        throw chartgen::Error(
+          "*** ERROR: no series with index " + std::to_string( idx )
+        );
+      }
+      series = &ctx->series[ idx ];
+    }
+  );
+  return series;
+}
+
+// The values are checked as when given in the input text.
+static void check_values(
+  const double* v, size_t n, const char* name, bool single
+)
+{
+  auto error = [&]( size_t i, const char* msg )
+  {
+    throw chartgen::Error(
+      std::string( "*** ERROR: " ) + name + "[" + std::to_string( i ) + "] " +
+      msg
+    );
+  };
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( v[ i ] == Chart::num_skip || v[ i ] == Chart::num_invalid ) continue;
+    if ( !(std::abs( v[ i ] ) <= Chart::num_hi) ) {
+      error( i, "is not a valid number" );
+    }
+    if ( single && !chartgen::Column::FitsFloat( v[ i ] ) ) {
+      error( i, "is too big for Float precision" );
+    }
+  }
+}
+
+int cg_series_add_xy(
+  cg_series_t* series, const double* x, const double* y, size_t n
+)
+{
+  return guard(
+    series->ctx,
+    [&]()
+    {
+      auto sd = series->sd;
+      if (
+        sd->type != Chart::SeriesType::XY &&
+        sd->type != Chart::SeriesType::Scatter
+      ) {
+        throw chartgen::Error(
+          "*** ERROR: series is not of type XY or Scatter"
+        );
+      }
+      check_values( x, n, "x", sd->SinglePrecision() );
+      check_values( y, n, "y", sd->SinglePrecision() );
+      if ( n > 0 ) sd->borrowed.push_back( { x, y, n } );
+    }
+  );
+}
+
+//------------------------------------------------------------------------------
+
+int cg_build( cg_context_t* ctx )
+{
+  return guard(
+    ctx,
+    [&]()
+    {
+      if ( ctx->built ) {
+        throw chartgen::Error( "*** ERROR: chart already built" );
+      }
+      ctx->built = true;
+      ctx->output = ctx->context.Build();
+    }
+  );
+}
+
+const char* cg_output( const cg_context_t* ctx )
+{
+  return ctx->output.c_str();
+}
+
+size_t cg_output_size( const cg_context_t* ctx )
+{
+  return ctx->output.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
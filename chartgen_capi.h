@@ -0,0 +1,89 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+// C interface to chartgen; build libchartgen.so with "make so".
+//
+// The chart is specified by normal chartgen input text, which is where the
+// styling is done. Series defined by the text may then get their data directly
+// from arrays in memory, which avoids formatting and parsing the data as text:
+//
+//   cg_context_t* ctx = cg_create();
+//   cg_add_text( ctx, "spec", "Series.Type: XY\nSeries.New: Sensor\n" );
+//   cg_parse( ctx );
+//   cg_series_add_xy( cg_get_series( ctx, 0 ), x, y, n );
+//   cg_build( ctx );
+//   fputs( cg_output( ctx ), stdout );
+//   cg_destroy( ctx );
+//
+// The data arrays are borrowed, not copied; they must stay valid until
+// cg_build has returned. Functions returning int return 0 on success and -1 on
+// failure, in which case cg_error gives the error message.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cg_context cg_context_t;
+typedef struct cg_series  cg_series_t;
+
+cg_context_t* cg_create( void );
+void cg_destroy( cg_context_t* ctx );
+
+// The message of the last error; empty if none.
+const char* cg_error( const cg_context_t* ctx );
+
+// Same as the corresponding command line options; zero means none.
+void cg_enable_html( cg_context_t* ctx, int enable );
+void cg_set_max_bytes( cg_context_t* ctx, uint64_t n );
+void cg_set_max_elements( cg_context_t* ctx, uint64_t n );
+void cg_set_target_width( cg_context_t* ctx, uint64_t n );
+void cg_set_deadline( cg_context_t* ctx, uint64_t ms );
+
+// Add chartgen input text; the name is used in error messages. Input cannot be
+// added after cg_parse.
+int cg_add_text( cg_context_t* ctx, const char* name, const char* text );
+
+// Add chartgen input from a file; "-" means standard input.
+int cg_add_file( cg_context_t* ctx, const char* file_name );
+
+// Parse all the added input, after which the series are available.
+int cg_parse( cg_context_t* ctx );
+
+// The series in the order they were defined by the input. The handles are
+// valid until cg_build is called.
+size_t cg_series_count( cg_context_t* ctx );
+cg_series_t* cg_get_series( cg_context_t* ctx, size_t idx );
+
+// Add n data points to an XY or Scatter series. Chart::num_skip and
+// Chart::num_invalid may be used like '-' and '!' in the input text; other
+// values must be numbers no bigger than Chart::num_hi.
+int cg_series_add_xy(
+  cg_series_t* series, const double* x, const double* y, size_t n
+);
+
+// Generate the SVG or HTML output; can only be called once.
+int cg_build( cg_context_t* ctx );
+
+// The generated output; valid until the context is destroyed.
+const char* cg_output( const cg_context_t* ctx );
+size_t cg_output_size( const cg_context_t* ctx );
+
+#ifdef __cplusplus
+}
+#endif
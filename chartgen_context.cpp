@@ -0,0 +1,3847 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <thread>
+#include <chartgen_context.h>
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+Context::Context( void )
+{
+  start_time = std::chrono::steady_clock::now();
+  cur_line = lines.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool is_ws( char c )
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void trunc_ws( std::string& s )
+{
+  while ( s.length() > 0 && is_ws( s.back() ) ) {
+    s.pop_back();
+  }
+}
+
+void trunc_nl( std::string& s )
+{
+  while ( s.length() > 0 ) {
+    if ( s.back() != '\r' && s.back() != '\n' ) break;
+    s.pop_back();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::save_line_pos( uint32_t context )
+{
+  saved_line[ context ] = cur_line;
+  saved_macro_stack[ context ] = macro_stack;
+}
+
+void Context::restore_line_pos( uint32_t context )
+{
+  cur_line = saved_line[ context ];
+  cur_col = 0;
+  macro_stack = saved_macro_stack[ context ];
+}
+
+
+bool Context::at_eof( void )
+{
+  return cur_line == lines.end();
+}
+
+bool Context::at_eol( void )
+{
+  if ( at_eof() ) return true;
+  if ( cur_col >= cur_line->line.length() ) return true;
+  if ( cur_col == 0 && cur_line->line[ 0 ] == '#' ) return true;
+  return false;
+}
+
+bool Context::at_ws( void )
+{
+  return !at_eol() && is_ws( cur_line->line[ cur_col ] );
+}
+
+void Context::skip_ws( bool multi_line )
+{
+  while ( !at_eof() ) {
+    while ( !at_eol() ) {
+      if ( !is_ws( cur_line->line[ cur_col ] ) ) return;
+      cur_col++;
+    }
+    if ( !multi_line ) break;
+    next_line();
+  }
+}
+
+void Context::parse_err( const std::string& msg, bool revert_col )
+{
+  std::ostringstream oss;
+
+  auto show_pos = [&]( LineRecIter lri, size_t col, bool stack = false )
+  {
+    oss
+      << file_names[ lri->file_name_idx ] << " ("
+      << lri->line_number << ','
+      << col << ')'
+      << (stack ? '>' : ':')
+      << '\n';
+  };
+
+  if ( revert_col ) cur_col = id_col;
+  oss << "*** PARSE ERROR: " << msg << "\n";
+  for ( auto lri : macro_stack ) {
+    show_pos( lri, 0, true );
+  }
+  if ( at_eof() ) {
+    oss << "at EOF";
+  } else {
+    if ( cur_col > cur_line->line.length() ) cur_col = cur_line->line.length();
+    show_pos( cur_line, cur_col );
+    oss << cur_line->line << '\n';
+    for ( size_t i = 0; i < cur_col; i++ ) {
+      oss << ' ';
+    }
+    oss << '^';
+  }
+  throw Error( oss.str() );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+char Context::get_char( bool adv )
+{
+  if ( at_eol() ) return '\r';
+  char c = cur_line->line[ cur_col ];
+  if ( adv ) cur_col++;
+  return c;
+}
+
+std::string Context::get_identifier( bool all_non_ws )
+{
+  id_col = cur_col;
+  std::string id = "";
+  while ( !at_eol() ) {
+    char c = cur_line->line[ cur_col ];
+    if (
+      (all_non_ws && !is_ws( c ) ) ||
+      (c >= 'a' && c <= 'z') ||
+      (c >= 'A' && c <= 'Z') ||
+      (c >= '0' && c <= '9') ||
+      (c == '.' || c == '-' || c == '+' || c == '_')
+    ) {
+      id.push_back( c );
+      cur_col++;
+    } else {
+      break;
+    }
+  }
+  return id;
+}
+
+// Attempts to parse an int64_t or double from the current position. If
+// successful the function returns true and the current position is advanced,
+// otherwise the function returns false and the current position is left
+// unchanged.
+bool Context::get_int64( int64_t& i )
+{
+  id_col = cur_col;
+  try {
+    std::string str( cur_line->line.substr( cur_col ) );
+    str.push_back( ' ' );
+    std::istringstream iss( str );
+    int64_t num;
+    if ( !(iss >> num).fail() ) {
+      cur_col += iss.tellg();
+      if ( !at_eol() && !at_ws() ) {
+        cur_col = id_col;
+        return false;
+      }
+      i = num;
+    } else {
+      return false;
+    }
+  } catch ( const std::exception& e ) {
+    return false;
+  }
+  return true;
+}
+bool Context::get_double( double& d, bool none_allowed )
+{
+  id_col = cur_col;
+  if ( none_allowed ) {
+    char c = get_char();
+    if ( (c == '-' || c == '!') && (at_eol() || at_ws()) ) {
+      d = (c == '!') ? Chart::num_invalid : Chart::num_skip;
+      return true;
+    }
+  }
+  cur_col = id_col;
+  try {
+    std::string str( cur_line->line.substr( cur_col ) );
+    str.push_back( ' ' );
+    std::istringstream iss( str );
+    double num;
+    if ( !(iss >> num).fail() ) {
+      cur_col += iss.tellg();
+      if ( !at_eol() && !at_ws() ) {
+        cur_col = id_col;
+        return false;
+      }
+      d = num;
+    } else {
+      return false;
+    }
+  } catch ( const std::exception& e ) {
+    return false;
+  }
+  if ( std::abs( d ) > Chart::num_hi ) {
+    parse_err( "number too big", true );
+  }
+  return true;
+}
+
+// Read in a text based X-value which defines a category for the series.
+// The text is returned as a view into the input line.
+bool Context::get_category( std::string_view& t, bool& quoted )
+{
+  quoted = false;
+  id_col = cur_col;
+  size_t b = cur_col;
+  size_t e = cur_col;
+  bool in_quote = false;
+  while ( !at_eol() ) {
+    char c = cur_line->line[ cur_col ];
+    if ( c == '"' ) {
+      if ( cur_col == id_col ) {
+        in_quote = true;
+        cur_col++;
+        b = e = cur_col;
+        continue;
+      } else {
+        if ( in_quote ) {
+          in_quote = false;
+          quoted = true;
+          cur_col++;
+        }
+        break;
+      }
+    }
+    if ( is_ws( c ) ) {
+      if ( !in_quote ) break;
+    }
+    cur_col++;
+    e = cur_col;
+  }
+  t = std::string_view( cur_line->line ).substr( b, e - b );
+  if ( in_quote ) return false;
+  if ( !quoted && t == "-" ) t = std::string_view();
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Context::get_key( std::string& key )
+{
+  key = "";
+  skip_ws( true );
+  if ( at_eof() ) return false;
+  if ( cur_col > 0 ) parse_err( "KEY must be unindented" );
+  key = get_identifier();
+  skip_ws();
+  if ( key == "" ) parse_err( "KEY expected" );
+  if ( get_char( false ) != ':' ) parse_err( "':' expected" );
+  get_char();
+  return true;
+}
+
+void Context::get_text( std::string& txt, bool multi_line )
+{
+  txt = "";
+  skip_ws();
+  while ( !at_eol() ) txt.push_back( get_char() );
+  trunc_ws( txt );
+  if ( txt != "" || !multi_line ) return;
+  next_line();
+  save_line_pos();
+  size_t indent = 0;
+  while ( !at_eof() ) {
+    while ( at_ws() ) cur_col++;
+    if ( !at_eol() ) {
+      if ( cur_col == 0 ) break;
+      if ( indent == 0 || cur_col < indent ) indent = cur_col;
+    }
+    next_line();
+  }
+  restore_line_pos();
+  if ( indent < 1 ) return;
+  while ( !at_eof() ) {
+    if ( txt != "" ) txt.push_back( '\n' );
+    while ( at_ws() ) cur_col++;
+    if ( !at_eol() ) {
+      if ( cur_col < indent ) break;
+      cur_col = indent;
+      while ( !at_eol() ) txt.push_back( get_char() );
+      trunc_ws( txt );
+    }
+    next_line();
+  }
+  trunc_ws( txt );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::expect_eol( void )
+{
+  skip_ws();
+  if ( !at_eol() ) parse_err( "garbage at EOL" );
+}
+
+void Context::expect_ws( const std::string err_msg_if_eol )
+{
+  auto old_col = cur_col;
+  skip_ws();
+  if ( cur_col > old_col && !at_eol() ) return;
+  if ( at_eol() && err_msg_if_eol != "" ) parse_err( err_msg_if_eol );
+  if ( cur_col == old_col ) parse_err( "whitespace expected" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::next_line( void )
+{
+  ++cur_line;
+
+  while ( true ) {
+    while ( cur_line != lines.end() && macro_stack.empty() && cur_line->macro ) {
+      ++cur_line;
+    }
+    if ( cur_line == lines.end() ) break;
+
+    if (
+      cur_line->line.size() >= 6 &&
+      cur_line->line.compare( 0, 6, "Macro:" ) == 0
+    ) {
+      cur_col = 6;
+      skip_ws();
+      std::string macro_name = get_identifier();
+      expect_eol();
+      auto it = macros.find( macro_name );
+      if ( it == macros.end() ) {
+        parse_err( "macro '" + macro_name + "' is undefined", true );
+      }
+      for ( auto lri : macro_stack ) {
+        if ( lri == cur_line ) {
+          parse_err( "circular macro call", true );
+        }
+      }
+      macro_stack.push_back( cur_line );
+      cur_line = lines.begin() + it->second + 1;
+      continue;
+    }
+
+    if ( cur_line->macro_end ) {
+      cur_line = ++macro_stack.back();
+      macro_stack.pop_back();
+      continue;
+    }
+
+    break;
+  }
+
+  cur_col = 0;
+  return;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::do_Pos(
+  Chart::Pos& pos, int& axis_y_n
+)
+{
+  std::string id = get_identifier( true );
+  if ( id == "Auto"    ) pos = Chart::Pos::Auto  ; else
+  if ( id == "Center"  ) pos = Chart::Pos::Center; else
+  if ( id == "Left"    ) pos = Chart::Pos::Left  ; else
+  if ( id == "Right"   ) pos = Chart::Pos::Right ; else
+  if ( id == "Top"     ) pos = Chart::Pos::Top   ; else
+  if ( id == "Bottom"  ) pos = Chart::Pos::Bottom; else
+  if ( id == "Above"   ) pos = Chart::Pos::Top   ; else
+  if ( id == "Below"   ) pos = Chart::Pos::Bottom; else
+  if ( id == "Base"    ) { pos = Chart::Pos::Base; axis_y_n = 0; } else
+  if ( id == "BaseY1"  ) { pos = Chart::Pos::Base; axis_y_n = 0; } else
+  if ( id == "BasePri" ) { pos = Chart::Pos::Base; axis_y_n = 0; } else
+  if ( id == "BaseY2"  ) { pos = Chart::Pos::Base; axis_y_n = 1; } else
+  if ( id == "BaseSec" ) { pos = Chart::Pos::Base; axis_y_n = 1; } else
+  if ( id == "End"     ) pos = Chart::Pos::End   ; else
+  if ( id == "Beyond"  ) pos = Chart::Pos::Beyond; else
+  if ( id == "" ) parse_err( "position expected" ); else
+  parse_err( "unknown position '" + id + "'", true );
+}
+
+void Context::do_Pos(
+  Chart::Pos& pos
+)
+{
+  int axis_y_n;
+  do_Pos( pos, axis_y_n );
+}
+
+void Context::do_Switch(
+  bool& flag
+)
+{
+  skip_ws();
+  std::string id = get_identifier( true );
+  if ( id == "On"  ) flag = true ; else
+  if ( id == "Off" ) flag = false; else
+  if ( id == "Yes" ) flag = true ; else
+  if ( id == "No"  ) flag = false; else
+  if ( id == "" ) parse_err( "On/Off (Yes/No) expected" ); else
+  parse_err( "On/Off (Yes/No) expected, saw '" + id + "'", true );
+}
+
+void Context::do_Color(
+  SVG::Color* color
+)
+{
+  skip_ws();
+  std::string color_id = get_identifier( true );
+
+  bool color_ok = true;
+
+  color->Clear();
+  color->SetTransparency( 0.0 );
+
+  if ( color_id != "None" ) {
+    if (color_id.size() != 7 || color_id[0] != '#') {
+      color_ok = false;
+    }
+    for ( char c : color_id.substr( 1 ) ) {
+      if ( !std::isxdigit( c ) ) color_ok = false;
+    }
+    if ( color_ok ) {
+      uint8_t r = static_cast<uint8_t>( std::stoi( color_id.substr(1, 2), nullptr, 16) );
+      uint8_t g = static_cast<uint8_t>( std::stoi( color_id.substr(3, 2), nullptr, 16) );
+      uint8_t b = static_cast<uint8_t>( std::stoi( color_id.substr(5, 2), nullptr, 16) );
+      color->Set( r, g, b );
+    } else {
+      color_ok = color->Set( color_id ) == color;
+    }
+  }
+
+  if ( !color_ok ) {
+    parse_err( "invalid color", true );
+  }
+
+  if ( !at_eol() ) {
+    double lighten = 0.0;
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( lighten ) ) {
+        parse_err( "malformed lighten value" );
+      }
+      if ( lighten < -1.0 || lighten > 1.0 ) {
+        parse_err( "lighten value out of range [-1.0;1.0]", true );
+      }
+      if ( lighten < 0 )
+        color->Darken( -lighten );
+      else
+        color->Lighten( lighten );
+    }
+  }
+
+  if ( !at_eol() ) {
+    double transparency = 0.0;
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( transparency ) ) {
+        parse_err( "malformed transparency value" );
+      }
+      if ( transparency < 0.0 || transparency > 1.0 ) {
+        parse_err( "transparency value out of range [0.0;1.0]", true );
+      }
+      color->SetTransparency( transparency );
+    }
+  }
+
+  expect_eol();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool Context::do_GridPos(
+  int64_t& row1, int64_t& col1,
+  int64_t& row2, int64_t& col2
+)
+{
+  bool got_pos = false;
+
+  skip_ws();
+
+  if ( get_int64( row1 ) ) {
+    if ( row1 < 0 || row1 > 99 ) {
+      parse_err( "grid row out of range [0;99]", true );
+    }
+
+    expect_ws( "column expected" );
+    if ( !get_int64( col1 ) ) parse_err( "malformed column" );
+    if ( col1 < 0 || col1 > 99 ) {
+      parse_err( "grid column out of range [0;99]", true );
+    }
+
+    row2 = row1;
+    col2 = col1;
+
+    skip_ws();
+
+    if ( get_int64( row2 ) ) {
+      if ( row2 < 0 || row2 > 99 ) {
+        parse_err( "grid row out of range [0;99]", true );
+      }
+
+      expect_ws( "column expected" );
+      if ( !get_int64( col2 ) ) parse_err( "malformed column" );
+      if ( col2 < 0 || col2 > 99 ) {
+        parse_err( "grid column out of range [0;99]", true );
+      }
+    }
+
+    got_pos = true;
+  }
+
+  return got_pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Chart::Main* Context::CurChart( void )
+{
+  if ( ensemble.Empty() ) {
+    non_newed_chart = true;
+    save_line_pos( 1 );
+    ensemble.NewChart( 0, 0, 0, 0 );
+  }
+  return ensemble.LastChart();
+}
+
+void Context::do_New( void )
+{
+  Chart::Pos align_hor = Chart::Pos::Auto;
+  Chart::Pos align_ver = Chart::Pos::Auto;
+
+  int64_t row1 = 0;
+  int64_t col1 = 0;
+  int64_t row2 = 0;
+  int64_t col2 = 0;
+  bool grid_given = do_GridPos( row1, col1, row2, col2 );
+
+  skip_ws();
+  if ( !at_eol() ) {
+    do_Pos( align_hor );
+    expect_ws( "vertical position expected" );
+    do_Pos( align_ver );
+  }
+
+  expect_eol();
+
+  if ( !grid_given && grid_max_defined ) {
+    row1 = grid_max_row + 1;
+    row2 = row1;
+    col1 = 0;
+    col2 = grid_max_col;
+  }
+
+  if ( row1 > row2 || col1 > col2 ) {
+    parse_err( "malformed grid location" );
+  }
+
+  if ( non_newed_chart ) {
+    restore_line_pos( 1 );
+    parse_err(
+      "chart specifiers must be preceded by New for multi chart plots"
+    );
+  }
+
+  if ( !ensemble.NewChart( row1, col1, row2, col2, align_hor, align_ver ) ) {
+    parse_err( "grid collision" );
+  }
+
+  grid_max_row = std::max( grid_max_row, static_cast<uint32_t>( row2 ) );
+  grid_max_col = std::max( grid_max_col, static_cast<uint32_t>( col2 ) );
+  grid_max_defined = true;
+
+  state = {};
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::do_Margin( void )
+{
+  double m;
+  skip_ws();
+  if ( at_eol() ) parse_err( "margin expected" );
+  if ( !get_double( m ) ) parse_err( "malformed margin" );
+  if ( m < 0 || m > 1000 ) {
+    parse_err( "margin out of range [0;1000]", true );
+  }
+  expect_eol();
+  ensemble.SetMargin( m );
+}
+
+void Context::do_BorderColor( void )
+{
+  do_Color( ensemble.BorderColor() );
+}
+
+void Context::do_BorderWidth( void )
+{
+  double m;
+  skip_ws();
+  if ( at_eol() ) parse_err( "border width expected" );
+  if ( !get_double( m ) ) parse_err( "malformed border width" );
+  if ( m < 0 || m > 1000 ) {
+    parse_err( "border width out of range [0;1000]", true );
+  }
+  expect_eol();
+  ensemble.SetBorderWidth( m );
+}
+
+void Context::do_Padding( void )
+{
+  double m;
+  skip_ws();
+  if ( at_eol() ) parse_err( "padding expected" );
+  if ( !get_double( m ) ) parse_err( "malformed padding" );
+  if ( m < 0 || m > 1000 ) {
+    parse_err( "padding out of range [0;1000]", true );
+  }
+  expect_eol();
+  ensemble.SetPadding( m );
+}
+
+void Context::do_GridPadding( void )
+{
+  double grid_padding;
+  double area_padding = 0;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "grid padding expected" );
+  if ( !get_double( grid_padding ) ) parse_err( "malformed grid padding" );
+  if ( grid_padding > 1000 ) {
+    parse_err( "grid padding out of range [-inf;1000]", true );
+  }
+
+  skip_ws();
+  if ( get_double( area_padding ) ) {
+    if ( area_padding < 0 || area_padding > 1000 ) {
+      parse_err( "chart area padding out of range [0;1000]", true );
+    }
+  }
+
+  expect_eol();
+  ensemble.SetGridPadding( grid_padding, area_padding );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_GlobalLegendHeading( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  ensemble.SetLegendHeading( txt );
+}
+
+void Context::do_GlobalLegendFrame( void )
+{
+  bool frame;
+  do_Switch( frame );
+  expect_eol();
+  ensemble.SetLegendFrame( frame );
+}
+
+void Context::do_GlobalLegendPos( void )
+{
+  int64_t row1 = 0;
+  int64_t col1 = 0;
+  int64_t row2 = 0;
+  int64_t col2 = 0;
+  Chart::Pos pos;
+  skip_ws();
+  if ( do_GridPos( row1, col1, row2, col2 ) ) {
+    Chart::Pos align_hor = Chart::Pos::Auto;
+    Chart::Pos align_ver = Chart::Pos::Auto;
+    skip_ws();
+    if ( !at_eol() ) {
+      do_Pos( align_hor );
+      expect_ws( "vertical position expected" );
+      do_Pos( align_ver );
+    }
+    expect_eol();
+    if (
+      !ensemble.SetLegendPos( row1, col1, row2, col2, align_hor, align_ver
+    ) ) {
+      parse_err( "grid collision" );
+    }
+  } else {
+    do_Pos( pos );
+    expect_eol();
+    ensemble.SetLegendPos( pos );
+  }
+}
+
+void Context::do_GlobalLegendSize( void )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "legend size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed Legend size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "legend size value out of range", true );
+  }
+  expect_eol();
+  ensemble.SetLegendSize( size );
+}
+
+void Context::do_GlobalLegendColor( void )
+{
+  do_Color( ensemble.LegendColor() );
+}
+
+void Context::do_LetterSpacing( void )
+{
+  double width_adj    = 1.0;
+  double height_adj   = 1.0;
+  double baseline_adj = 1.0;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "width adjustment expected" );
+  if ( !get_double( width_adj ) ) {
+    parse_err( "malformed width adjustment" );
+  }
+  if ( width_adj < 0 || width_adj > 100 ) {
+    parse_err( "width adjustment out of range [0;100]", true );
+  }
+
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( height_adj ) ) {
+        parse_err( "malformed height adjustment" );
+      }
+      if ( height_adj < 0 || height_adj > 100 ) {
+        parse_err( "height adjustment out of range [0;100]", true );
+      }
+    }
+  }
+
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( baseline_adj ) ) {
+        parse_err( "malformed baseline adjustment" );
+      }
+      if ( baseline_adj < 0 || baseline_adj > 100 ) {
+        parse_err( "baseline adjustment out of range [0;100]", true );
+      }
+    }
+  }
+
+  expect_eol();
+
+  ensemble.SetLetterSpacing( width_adj, height_adj, baseline_adj );
+  letter_width_adj = width_adj;
+  letter_height_adj = height_adj;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::do_ChartArea( void )
+{
+  int64_t w;
+  int64_t h;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "width expected" );
+  if ( !get_int64( w ) ) parse_err( "malformed width" );
+  if ( w < 10 || w > 100000 ) {
+    parse_err( "width out of range [10;100000]", true );
+  }
+
+  expect_ws( "height expected" );
+  if ( !get_int64( h ) ) parse_err( "malformed height" );
+  if ( h < 10 || h > 100000 ) {
+    parse_err( "height out of range [10;100000]", true );
+  }
+
+  expect_eol();
+  CurChart()->SetChartArea( w, h );
+  chart_info[ CurChart() ].area_w = w;
+  chart_info[ CurChart() ].area_h = h;
+}
+
+void Context::do_ChartBox( void )
+{
+  bool chart_box;
+  do_Switch( chart_box );
+  expect_eol();
+  CurChart()->SetChartBox( chart_box );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_ForegroundColor( void )
+{
+  do_Color( ensemble.ForegroundColor() );
+}
+
+void Context::do_BackgroundColor( void )
+{
+  do_Color( ensemble.BackgroundColor() );
+}
+
+void Context::do_ChartAreaColor( void )
+{
+  do_Color( CurChart()->ChartAreaColor() );
+}
+
+void Context::do_AxisColor( void )
+{
+  do_Color( CurChart()->AxisColor() );
+}
+
+void Context::do_GridColor( void )
+{
+  do_Color( CurChart()->AxisX()->GridColor() );
+  for ( auto n : { 0, 1 } ) {
+    CurChart()->AxisY( n )->GridColor()->Set( CurChart()->AxisX()->GridColor() );
+  }
+}
+
+void Context::do_TextColor( void )
+{
+  do_Color( CurChart()->TextColor() );
+}
+
+void Context::do_FrameColor( void )
+{
+  do_Color( CurChart()->FrameColor() );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_GlobalTitle( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  ensemble.SetTitle( txt );
+}
+
+void Context::do_GlobalSubTitle( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  ensemble.SetSubTitle( txt );
+}
+
+void Context::do_GlobalSubSubTitle( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  ensemble.SetSubSubTitle( txt );
+}
+
+void Context::do_GlobalTitlePos( void )
+{
+  Chart::Pos pos;
+  skip_ws();
+  do_Pos( pos );
+  expect_eol();
+  ensemble.SetTitlePos( pos );
+}
+
+void Context::do_GlobalTitleSize( void )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "title size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed title size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "title size value out of range", true );
+  }
+  expect_eol();
+  ensemble.SetTitleSize( size );
+}
+
+void Context::do_GlobalTitleLine( void )
+{
+  bool title_line;
+  do_Switch( title_line );
+  expect_eol();
+  ensemble.SetTitleLine( title_line );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Title( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  CurChart()->SetTitle( txt );
+}
+
+void Context::do_SubTitle( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  CurChart()->SetSubTitle( txt );
+}
+
+void Context::do_SubSubTitle( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  CurChart()->SetSubSubTitle( txt );
+}
+
+void Context::do_TitleFrame( void )
+{
+  bool frame;
+  do_Switch( frame );
+  expect_eol();
+  CurChart()->SetTitleFrame( frame );
+}
+
+void Context::do_TitlePos( void )
+{
+  Chart::Pos pos_x;
+  Chart::Pos pos_y = Chart::Pos::Top;
+
+  skip_ws();
+  do_Pos( pos_x );
+
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      do_Pos( pos_y );
+    }
+  }
+
+  expect_eol();
+  CurChart()->SetTitlePos( pos_x, pos_y );
+}
+
+void Context::do_TitleInside( void )
+{
+  bool inside;
+  do_Switch( inside );
+  expect_eol();
+  CurChart()->SetTitleInside( inside );
+}
+
+void Context::do_TitleSize( void )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "title size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed title size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "title size value out of range", true );
+  }
+  expect_eol();
+  CurChart()->SetTitleSize( size );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Footnote( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  ensemble.AddFootnote( txt );
+  ensemble.SetFootnotePos( footnote_pos );
+}
+
+void Context::do_FootnotePos( void )
+{
+  skip_ws();
+  do_Pos( footnote_pos );
+  expect_eol();
+  ensemble.SetFootnotePos( footnote_pos );
+}
+
+void Context::do_FootnoteLine( void )
+{
+  bool footnote_line;
+  do_Switch( footnote_line );
+  expect_eol();
+  ensemble.SetFootnoteLine( footnote_line );
+}
+
+void Context::do_FootnoteSize( void )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "footnote size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed footnote size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "footnote size value out of range", true );
+  }
+  expect_eol();
+  ensemble.SetFootnoteSize( size );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Orientation( Chart::Axis* axis )
+{
+  bool vertical;
+
+  skip_ws();
+  std::string id = get_identifier( true );
+  if ( id == "Horizontal" ) vertical = false; else
+  if ( id == "Vertical"   ) vertical = true ; else
+  if ( id == "" ) parse_err( "axis orientation expected" ); else
+  parse_err( "unknown axis orientation '" + id + "'", true );
+  expect_eol();
+
+  vertical = (axis == CurChart()->AxisX()) ? vertical : !vertical;
+  CurChart()->AxisX(   )->SetAngle( vertical ? 90 :  0 );
+  CurChart()->AxisY( 0 )->SetAngle( vertical ?  0 : 90 );
+  CurChart()->AxisY( 1 )->SetAngle( vertical ?  0 : 90 );
+  chart_info[ CurChart() ].x_vertical = vertical;
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Reverse( Chart::Axis* axis )
+{
+  bool reverse;
+  do_Switch( reverse );
+  expect_eol();
+  axis->SetReverse( reverse );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Style( Chart::Axis* axis )
+{
+  Chart::AxisStyle style;
+  skip_ws();
+
+  std::string id = get_identifier( true );
+  if ( id == "Auto"   ) style = Chart::AxisStyle::Auto ; else
+  if ( id == "None"   ) style = Chart::AxisStyle::None ; else
+  if ( id == "Line"   ) style = Chart::AxisStyle::Line ; else
+  if ( id == "Arrow"  ) style = Chart::AxisStyle::Arrow; else
+  if ( id == "Edge"   ) style = Chart::AxisStyle::Edge ; else
+  if ( id == "" ) parse_err( "axis style expected" ); else
+  parse_err( "unknown axis style '" + id + "'", true );
+
+  expect_eol();
+  axis->SetStyle( style );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Label( Chart::Axis* axis )
+{
+  std::string txt;
+  get_text( txt, true );
+  axis->SetLabel( txt );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_SubLabel( Chart::Axis* axis )
+{
+  std::string txt;
+  get_text( txt, true );
+  axis->SetSubLabel( txt );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_LabelSize( Chart::Axis* axis )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "label size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed label size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "label size value out of range", true );
+  }
+  expect_eol();
+  axis->SetLabelSize( size );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Unit( Chart::Axis* axis )
+{
+  std::string txt;
+  get_text( txt, true );
+  axis->SetUnit( txt );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_UnitPos( Chart::Axis* axis )
+{
+  Chart::Pos pos;
+  skip_ws();
+  do_Pos( pos );
+  expect_eol();
+  axis->SetUnitPos( pos );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_LogScale( Chart::Axis* axis )
+{
+  bool log_scale;
+  do_Switch( log_scale );
+  expect_eol();
+  axis->SetLogScale( log_scale );
+  ChartInfo& info = chart_info[ CurChart() ];
+  if ( axis == CurChart()->AxisX(   ) ) info.x_log      = log_scale;
+  if ( axis == CurChart()->AxisY( 0 ) ) info.y_log[ 0 ] = log_scale;
+  if ( axis == CurChart()->AxisY( 1 ) ) info.y_log[ 1 ] = log_scale;
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Range( Chart::Axis* axis )
+{
+  double min;
+  double max;
+  double cross;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "min expected" );
+  if ( !get_double( min ) ) parse_err( "malformed min" );
+
+  expect_ws( "max expected" );
+  if ( !get_double( max ) ) parse_err( "malformed max" );
+  if ( !(max > min) ) parse_err( "max must be greater than min", true );
+
+  cross = 0;
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( cross ) ) parse_err( "malformed orthogonal axis cross" );
+    }
+  }
+
+  expect_eol();
+
+  axis->SetRange( min, max, cross );
+  ChartInfo& info = chart_info[ CurChart() ];
+  for ( int n = 0; n < 2; n++ ) {
+    if ( axis == CurChart()->AxisY( n ) ) {
+      info.y_range[ n ] = true;
+      info.y_min[ n ] = min;
+      info.y_max[ n ] = max;
+    }
+  }
+  if ( axis == CurChart()->AxisX() ) {
+    info.x_range = true;
+    info.x_min = min;
+    info.x_max = max;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Pos( Chart::Axis* axis )
+{
+  Chart::Pos pos;
+  int axis_y_n;
+  skip_ws();
+  do_Pos( pos, axis_y_n );
+  expect_eol();
+  axis->SetPos( pos, axis_y_n );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Tick( Chart::Axis* axis )
+{
+  double major;
+  int64_t minor;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "major tick expected" );
+  if ( !get_double( major ) ) parse_err( "malformed major tick" );
+  if ( !(major > 0) ) parse_err( "major tick must be positive", true );
+
+  expect_ws( "minor tick expected" );
+  if ( !get_int64( minor ) ) parse_err( "malformed minor tick" );
+  if ( minor < 0 || minor > 100 ) {
+    parse_err( "minor tick out of range [0;100]", true );
+  }
+
+  expect_eol();
+
+  axis->SetTick( major, minor );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_TickSpacing( Chart::Axis* axis )
+{
+  int64_t start = 0;
+  int64_t stride = 1;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "start expected" );
+  if ( !get_int64( start ) ) {
+    if ( axis != CurChart()->AxisX() || get_identifier() != "Auto" ) {
+      parse_err( "malformed start" );
+    }
+    expect_eol();
+    chart_info[ CurChart() ].auto_tick_spacing = true;
+    return;
+  }
+  if ( start < 0 ) {
+    parse_err( "invalid start position", true );
+  }
+
+  skip_ws();
+  if ( get_int64( stride ) ) {
+    if ( stride < 1 ) {
+      parse_err( "stride must be greater than zero", true );
+    }
+  }
+
+  expect_eol();
+  axis->SetTickSpacing( start, stride );
+  if ( axis == CurChart()->AxisX() ) {
+    chart_info[ CurChart() ].auto_tick_spacing = false;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_Grid( Chart::Axis* axis )
+{
+  bool major;
+  bool minor;
+
+  do_Switch( major );
+
+  minor = major;
+
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      do_Switch( minor );
+    }
+  }
+
+  expect_eol();
+
+  axis->SetGrid( major, minor );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_GridStyle( Chart::Axis* axis )
+{
+  Chart::GridStyle style;
+  skip_ws();
+  std::string id = get_identifier( true );
+  if ( id == "Auto"  ) style = Chart::GridStyle::Auto ; else
+  if ( id == "Dash"  ) style = Chart::GridStyle::Dash ; else
+  if ( id == "Solid" ) style = Chart::GridStyle::Solid; else
+  if ( id == "" ) parse_err( "grid style expected" ); else
+  parse_err( "unknown grid style '" + id + "'", true );
+  expect_eol();
+  axis->SetGridStyle( style );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_GridColor( Chart::Axis* axis )
+{
+  do_Color( axis->GridColor() );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_NumberFormat( Chart::Axis* axis )
+{
+  Chart::NumberFormat number_format;
+  skip_ws();
+
+  std::string id = get_identifier( true );
+  if ( id == "Auto"       ) number_format = Chart::NumberFormat::Auto      ; else
+  if ( id == "None"       ) number_format = Chart::NumberFormat::None      ; else
+  if ( id == "Fixed"      ) number_format = Chart::NumberFormat::Fixed     ; else
+  if ( id == "Scientific" ) number_format = Chart::NumberFormat::Scientific; else
+  if ( id == "Magnitude"  ) number_format = Chart::NumberFormat::Magnitude ; else
+  if ( id == "" ) parse_err( "number format expected" ); else
+  parse_err( "unknown number format '" + id + "'", true );
+
+  expect_eol();
+  axis->SetNumberFormat( number_format );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_NumberSign( Chart::Axis* axis )
+{
+  bool number_sign;
+  do_Switch( number_sign );
+  expect_eol();
+  axis->SetNumberSign( number_sign );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_NumberUnit( Chart::Axis* axis )
+{
+  std::string txt;
+  get_text( txt, false );
+  for ( char& c : txt ) {
+    if ( c != '_' ) break;
+    c = ' ';
+  }
+  axis->SetNumberUnit( txt );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_MinorNumber( Chart::Axis* axis )
+{
+  bool minor_num;
+  do_Switch( minor_num );
+  expect_eol();
+  axis->ShowMinorNumbers( minor_num );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_NumberPos( Chart::Axis* axis )
+{
+  Chart::Pos pos;
+  skip_ws();
+  do_Pos( pos );
+  expect_eol();
+  axis->SetNumberPos( pos );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Axis_NumberSize( Chart::Axis* axis )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "number size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed number size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "number size value out of range", true );
+  }
+  expect_eol();
+  axis->SetNumberSize( size );
+  if ( axis == CurChart()->AxisX() ) {
+    chart_info[ CurChart() ].x_number_size = size;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_LegendHeading( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  CurChart()->SetLegendHeading( txt );
+}
+
+void Context::do_LegendFrame( void )
+{
+  bool frame;
+  do_Switch( frame );
+  expect_eol();
+  CurChart()->SetLegendFrame( frame );
+}
+
+void Context::do_LegendPos( void )
+{
+  Chart::Pos pos;
+  skip_ws();
+  do_Pos( pos );
+  expect_eol();
+  CurChart()->SetLegendPos( pos );
+}
+
+void Context::do_LegendSize( void )
+{
+  double size;
+  skip_ws();
+  if ( at_eol() ) parse_err( "legend size value expected" );
+  if ( !get_double( size ) ) {
+    parse_err( "malformed Legend size value" );
+  }
+  if ( size < 0.01 || size > 100 ) {
+    parse_err( "legend size value out of range", true );
+  }
+  expect_eol();
+  CurChart()->SetLegendSize( size );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_BarWidth( void )
+{
+  double one_width;
+  double all_width;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "width expected" );
+  if ( !get_double( one_width ) ) parse_err( "malformed width" );
+  if ( one_width < 0.0 || one_width > 1.0 ) {
+    parse_err( "relative width out of range [0.0;1.0]", true );
+  }
+
+  all_width = 1.0;
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( all_width ) ) parse_err( "malformed width" );
+      if ( all_width < 0.0 || all_width > 1.0 ) {
+        parse_err( "relative width out of range [0.0;1.0]", true );
+      }
+    }
+  }
+
+  expect_eol();
+
+  CurChart()->SetBarWidth( one_width, all_width );
+}
+
+void Context::do_LayeredBarWidth( void )
+{
+  double width;
+  skip_ws();
+  if ( at_eol() ) parse_err( "width expected" );
+  if ( !get_double( width ) ) parse_err( "malformed width" );
+  if ( width <= 0.0 || width > 1.0 ) parse_err( "invalid width", true );
+  expect_eol();
+  CurChart()->SetLayeredBarWidth( width );
+}
+
+void Context::do_BarMargin( void )
+{
+  double margin;
+
+  skip_ws();
+  if ( at_eol() ) parse_err( "margin expected" );
+  if ( !get_double( margin ) ) parse_err( "malformed margin" );
+  if ( margin < 0.0 ) parse_err( "invalid margin", true );
+
+  expect_eol();
+
+  CurChart()->SetBarMargin( margin );
+}
+
+//------------------------------------------------------------------------------
+
+void Context::NextSeriesStyle( void )
+{
+  state.style = (state.style + 1) % 80;
+}
+
+void Context::ApplyMarkerSize( Chart::Series* series )
+{
+  if ( state.marker_size >= 0 ) {
+    if (
+      state.marker_size == 0 &&
+      ( state.series_type == Chart::SeriesType::Scatter ||
+        state.series_type == Chart::SeriesType::Point
+      )
+    ) {
+      state.series_list.back()->SetMarkerSize( 12 );
+    } else {
+      state.series_list.back()->SetMarkerSize( state.marker_size );
+    }
+  }
+}
+
+// A new Chart::Series starts out with the same defaults as the initial state
+// (see state_t), so only the properties that differ from those are set. With
+// thousands of series most then only get their style.
+void Context::AddSeries( std::string name, bool anonymous_snap )
+{
+  static const state_t defaults;
+  if ( !state.series_type_defined ) {
+    cur_col = 0;
+    parse_err( "undefined SeriesType" );
+  }
+  state.type_list.push_back( state.series_type );
+  state.series_list.push_back( CurChart()->AddSeries( state.series_type ) );
+  series_data.push_back(
+    { CurChart(), state.series_list.back(), state.series_type }
+  );
+  state.data_list.push_back( &series_data.back() );
+  state.data_list.back()->axis_y_n = state.axis_y_n;
+  state.data_list.back()->prune_dist = state.prune_dist;
+  state.data_list.back()->raster = state.raster;
+  state.data_list.back()->tag_enable = state.tag_enable;
+  state.data_list.back()->tag_size = state.tag_size;
+  state.data_list.back()->tag_overlap = state.tag_overlap;
+  state.data_list.back()->tag_filter = state.tag_filter;
+  state.data_list.back()->tag_filter_n = state.tag_filter_n;
+  state.data_list.back()->SetSinglePrecision( state.single_precision );
+  state.data_list.back()->clip_ingest = state.clip_ingest;
+  state.data_list.back()->contour = state.contour;
+  Chart::Series* series = state.series_list.back();
+  if ( !name.empty() ) series->SetName( name );
+  if ( anonymous_snap ) series->SetAnonymousSnap( true );
+  if ( state.prune_dist != defaults.prune_dist ) {
+    series->SetPruneDist( state.prune_dist );
+  }
+  if ( state.global_legend != defaults.global_legend ) {
+    series->SetGlobalLegend( state.global_legend );
+  }
+  if ( state.legend_outline != defaults.legend_outline ) {
+    series->SetLegendOutline( state.legend_outline );
+  }
+  if ( state.axis_y_n != defaults.axis_y_n ) {
+    series->SetAxisY( state.axis_y_n );
+  }
+  if ( state.series_base != defaults.series_base ) {
+    series->SetBase( state.series_base );
+  }
+  series->SetStyle( state.style );
+  NextSeriesStyle();
+  if ( state.marker_shape != defaults.marker_shape ) {
+    series->SetMarkerShape( state.marker_shape );
+  }
+  ApplyMarkerSize( series );
+  if ( state.line_width >= 0 ) {
+    series->SetLineWidth( state.line_width );
+  }
+  if ( state.line_dash >= 0 ) {
+    series->SetLineDash( state.line_dash, state.line_hole );
+  }
+  if ( state.fill_transparency >= 0 ) {
+    series->FillColor()->SetTransparency( state.fill_transparency );
+  }
+  if ( state.lighten != defaults.lighten ) {
+    series->LineColor()->Lighten( state.lighten );
+    series->FillColor()->Lighten( state.lighten );
+  }
+  if ( state.tag_enable != defaults.tag_enable ) {
+    series->SetTagEnable( state.tag_enable );
+  }
+  if ( state.tag_pos != defaults.tag_pos ) {
+    series->SetTagPos( state.tag_pos );
+  }
+  if ( state.tag_size != defaults.tag_size ) {
+    series->SetTagSize( state.tag_size );
+  }
+  if ( state.tag_box != defaults.tag_box ) {
+    series->SetTagBox( state.tag_box );
+  }
+  if ( state.tag_colors ) {
+    series->TagTextColor()->Set( &state.tag_text_color );
+    series->TagFillColor()->Set( &state.tag_fill_color );
+    series->TagLineColor()->Set( &state.tag_line_color );
+  }
+  state.defining_series = true;
+}
+
+void Context::do_Series_Type( void )
+{
+  skip_ws();
+  std::string id = get_identifier( true );
+  state.contour = id == "Contour";
+  if ( state.contour ) id = "XY";
+  if ( id == "XY"          ) state.series_type = Chart::SeriesType::XY         ; else
+  if ( id == "Scatter"     ) state.series_type = Chart::SeriesType::Scatter    ; else
+  if ( id == "Line"        ) state.series_type = Chart::SeriesType::Line       ; else
+  if ( id == "Point"       ) state.series_type = Chart::SeriesType::Point      ; else
+  if ( id == "Lollipop"    ) state.series_type = Chart::SeriesType::Lollipop   ; else
+  if ( id == "Bar"         ) state.series_type = Chart::SeriesType::Bar        ; else
+  if ( id == "StackedBar"  ) state.series_type = Chart::SeriesType::StackedBar ; else
+  if ( id == "LayeredBar"  ) state.series_type = Chart::SeriesType::LayeredBar ; else
+  if ( id == "Area"        ) state.series_type = Chart::SeriesType::Area       ; else
+  if ( id == "StackedArea" ) state.series_type = Chart::SeriesType::StackedArea; else
+  if ( id == "" ) parse_err( "series type expected" ); else
+  parse_err( "unknown series type '" + id + "'", true );
+  expect_eol();
+  state.series_type_defined = true;
+}
+
+void Context::do_Series_New( void )
+{
+  std::string txt;
+  get_text( txt, true );
+  AddSeries( txt );
+}
+
+void Context::do_Series_Prune( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "prune distance expected" );
+  if ( !get_double( state.prune_dist ) ) parse_err( "malformed prune distance" );
+  if ( state.prune_dist < 0 || state.prune_dist > 100 ) {
+    parse_err( "prune distance out of range [0;100]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetPruneDist( state.prune_dist );
+    state.data_list.back()->prune_dist = state.prune_dist;
+  }
+}
+
+void Context::do_Series_Raster( void )
+{
+  do_Switch( state.raster );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.data_list.back()->raster = state.raster;
+  }
+}
+
+void Context::do_Series_Precision( void )
+{
+  skip_ws();
+  std::string id = get_identifier();
+  if ( id == "Double" ) state.single_precision = false; else
+  if ( id == "Float"  ) state.single_precision = true ; else
+  if ( id == "" ) parse_err( "precision expected" ); else
+  parse_err( "unknown precision '" + id + "'", true );
+  expect_eol();
+  if ( state.defining_series && state.data_list.back()->Size() == 0 ) {
+    state.data_list.back()->SetSinglePrecision( state.single_precision );
+  }
+}
+
+void Context::do_Series_Clip( void )
+{
+  skip_ws();
+  std::string id = get_identifier();
+  if ( id == "Off"    ) state.clip_ingest = false; else
+  if ( id == "Ingest" ) state.clip_ingest = true ; else
+  if ( id == "" ) parse_err( "clip mode expected" ); else
+  parse_err( "unknown clip mode '" + id + "'", true );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.data_list.back()->clip_ingest = state.clip_ingest;
+  }
+}
+
+void Context::do_Series_Columns( void )
+{
+  state.columns.clear();
+  skip_ws();
+  if ( at_eol() ) parse_err( "columns expected" );
+  auto save_col = cur_col;
+  if ( get_identifier() == "All" ) {
+    expect_eol();
+    return;
+  }
+  cur_col = save_col;
+  while ( !at_eol() ) {
+    int64_t c;
+    if ( !get_int64( c ) ) parse_err( "malformed column number" );
+    if ( c < 1 || c > 1000000 ) parse_err( "column number out of range", true );
+    if (
+      std::find( state.columns.begin(), state.columns.end(), c ) !=
+      state.columns.end()
+    ) {
+      parse_err( "column selected more than once", true );
+    }
+    state.columns.push_back( c );
+    skip_ws();
+  }
+  expect_eol();
+}
+
+void Context::do_Series_GlobalLegend( void )
+{
+  do_Switch( state.global_legend );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetGlobalLegend( state.global_legend );
+  }
+}
+
+void Context::do_Series_LegendOutline( void )
+{
+  do_Switch( state.legend_outline );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetLegendOutline( state.legend_outline );
+  }
+}
+
+void Context::do_Series_Axis( void )
+{
+  skip_ws();
+  std::string id = get_identifier( true );
+  if ( id == "Primary"   ) state.axis_y_n = 0; else
+  if ( id == "Y1"        ) state.axis_y_n = 0; else
+  if ( id == "Secondary" ) state.axis_y_n = 1; else
+  if ( id == "Y2"        ) state.axis_y_n = 1; else
+  if ( id == "" ) parse_err( "Primary/Y1 or Secondary/Y2 expected" ); else
+  parse_err( "unknown Y-axis '" + id + "'", true );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetAxisY( state.axis_y_n );
+    state.data_list.back()->axis_y_n = state.axis_y_n;
+  }
+}
+
+void Context::do_Series_Base( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "base expected" );
+  if ( !get_double( state.series_base ) ) parse_err( "malformed base" );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetBase( state.series_base );
+  }
+}
+
+void Context::do_Series_Style( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "style expected" );
+  if ( !get_int64( state.style ) ) parse_err( "malformed style" );
+  if ( state.style < 0 || state.style > 79 ) {
+    parse_err( "style out of range [0;79]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetStyle( state.style );
+    NextSeriesStyle();
+    state.series_list.back()->LineColor()->Lighten( state.lighten );
+    state.series_list.back()->FillColor()->Lighten( state.lighten );
+    state.series_list.back()->TagTextColor()->Undef();
+    state.series_list.back()->TagFillColor()->Undef();
+    state.series_list.back()->TagLineColor()->Undef();
+  }
+  state.marker_size = -1;
+  state.line_width = -1;
+  state.line_dash = -1;
+  state.line_hole = -1;
+  state.fill_transparency = -1;
+  state.tag_text_color.Undef();
+  state.tag_fill_color.Undef();
+  state.tag_line_color.Undef();
+  state.tag_colors = false;
+}
+
+void Context::do_Series_MarkerShape( void )
+{
+  skip_ws();
+  std::string id = get_identifier( true );
+  if ( id == "Circle"      ) state.marker_shape = Chart::MarkerShape::Circle     ; else
+  if ( id == "Square"      ) state.marker_shape = Chart::MarkerShape::Square     ; else
+  if ( id == "Triangle"    ) state.marker_shape = Chart::MarkerShape::Triangle   ; else
+  if ( id == "InvTriangle" ) state.marker_shape = Chart::MarkerShape::InvTriangle; else
+  if ( id == "Diamond"     ) state.marker_shape = Chart::MarkerShape::Diamond    ; else
+  if ( id == "Cross"       ) state.marker_shape = Chart::MarkerShape::Cross      ; else
+  if ( id == "LineX"       ) state.marker_shape = Chart::MarkerShape::LineX      ; else
+  if ( id == "LineY"       ) state.marker_shape = Chart::MarkerShape::LineY      ; else
+  if ( id == "" ) parse_err( "marker shape expected" ); else
+  parse_err( "unknown marker shape '" + id + "'", true );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetMarkerShape( state.marker_shape );
+  }
+}
+
+void Context::do_Series_MarkerSize( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "marker size expected" );
+  if ( !get_double( state.marker_size ) ) parse_err( "malformed marker size" );
+  if ( state.marker_size < 0 || state.marker_size > 100 ) {
+    parse_err( "marker size out of range [0;100]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    ApplyMarkerSize( state.series_list.back() );
+  }
+}
+
+void Context::do_Series_LineWidth( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "line width expected" );
+  if ( !get_double( state.line_width ) ) parse_err( "malformed line width" );
+  if ( state.line_width < 0 || state.line_width > 100 ) {
+    parse_err( "line width out of range [0;100]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetLineWidth( state.line_width );
+  }
+}
+
+void Context::do_Series_LineDash( void )
+{
+  state.line_dash = 0;
+  skip_ws();
+  if ( at_eol() ) parse_err( "line dash expected" );
+  if ( !get_double( state.line_dash ) ) {
+    parse_err( "malformed line dash" );
+  }
+  if ( state.line_dash < 0 || state.line_dash > 100 ) {
+    parse_err( "line dash out of range [0;100]", true );
+  }
+  state.line_hole = state.line_dash;
+  if ( !at_eol() ) {
+    expect_ws();
+    if ( !at_eol() ) {
+      if ( !get_double( state.line_hole ) ) {
+        parse_err( "malformed line hole" );
+      }
+      if ( state.line_hole < 0 || state.line_hole > 100 ) {
+        parse_err( "line hole out of range [0;100]", true );
+      }
+    }
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetLineDash( state.line_dash, state.line_hole );
+  }
+}
+
+void Context::do_Series_Lighten( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "lighten value expected" );
+  if ( !get_double( state.lighten ) ) {
+    parse_err( "malformed lighten value" );
+  }
+  if ( state.lighten < -1.0 || state.lighten > +1.0 ) {
+    parse_err( "lighten value out of range [-1.0;1.0]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->LineColor()->Lighten( state.lighten );
+    state.series_list.back()->FillColor()->Lighten( state.lighten );
+  }
+}
+
+void Context::do_Series_FillTransparency( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "transparency value expected" );
+  if ( !get_double( state.fill_transparency ) ) {
+    parse_err( "malformed transparency value" );
+  }
+  if ( state.fill_transparency < 0.0 || state.fill_transparency > 1.0 ) {
+    parse_err( "transparency value out of range [-1.0;1.0]", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->FillColor()->SetTransparency( state.fill_transparency );
+  }
+}
+
+void Context::do_Series_LineColor( void )
+{
+  if ( !state.defining_series ) {
+    parse_err( "LineColor outside defining series" );
+  }
+  do_Color( state.series_list.back()->LineColor() );
+  state.series_list.back()->LineColor()->Lighten( state.lighten );
+}
+
+void Context::do_Series_FillColor( void )
+{
+  if ( !state.defining_series ) {
+    parse_err( "FillColor outside defining series" );
+  }
+  do_Color( state.series_list.back()->FillColor() );
+  state.series_list.back()->FillColor()->Lighten( state.lighten );
+  if ( state.fill_transparency >= 0 ) {
+    state.series_list.back()->FillColor()->SetTransparency( state.fill_transparency );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Series_Tag( void )
+{
+  do_Switch( state.tag_enable );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetTagEnable( state.tag_enable );
+    state.data_list.back()->tag_enable = state.tag_enable;
+  }
+}
+
+void Context::do_Series_TagPos( void )
+{
+  skip_ws();
+  do_Pos( state.tag_pos );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetTagPos( state.tag_pos );
+  }
+}
+
+void Context::do_Series_TagSize( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "tag size value expected" );
+  if ( !get_double( state.tag_size ) ) {
+    parse_err( "malformed tag size value" );
+  }
+  if ( state.tag_size < 0.01 || state.tag_size > 100 ) {
+    parse_err( "tag size value out of range", true );
+  }
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetTagSize( state.tag_size );
+    state.data_list.back()->tag_size = state.tag_size;
+  }
+}
+
+void Context::do_Series_TagBox( void )
+{
+  do_Switch( state.tag_box );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.series_list.back()->SetTagBox( state.tag_box );
+  }
+}
+
+void Context::do_Series_TagOverlap( void )
+{
+  do_Switch( state.tag_overlap );
+  expect_eol();
+  if ( state.defining_series ) {
+    state.data_list.back()->tag_overlap = state.tag_overlap;
+  }
+}
+
+void Context::do_Series_TagFilter( void )
+{
+  skip_ws();
+  std::string id = get_identifier();
+  int64_t n = 0;
+  auto get_n = [&]( void )
+  {
+    skip_ws();
+    if ( at_eol() ) parse_err( "count expected" );
+    if ( !get_int64( n ) ) parse_err( "malformed count" );
+    if ( n < 1 ) parse_err( "count must be greater than zero", true );
+  };
+  if ( id == "All"     ) state.tag_filter = TagFilter::All    ; else
+  if ( id == "Extrema" ) state.tag_filter = TagFilter::Extrema; else
+  if ( id == "TopN"    ) state.tag_filter = TagFilter::TopN   ; else
+  if ( id == "Every"   ) state.tag_filter = TagFilter::Every  ; else
+  if ( id == "Last"    ) state.tag_filter = TagFilter::Last   ; else
+  if ( id == "" ) parse_err( "tag filter expected" ); else
+  parse_err( "unknown tag filter '" + id + "'", true );
+  if (
+    state.tag_filter == TagFilter::TopN ||
+    state.tag_filter == TagFilter::Every
+  ) {
+    get_n();
+  }
+  expect_eol();
+  state.tag_filter_n = n;
+  if ( state.defining_series ) {
+    state.data_list.back()->tag_filter = state.tag_filter;
+    state.data_list.back()->tag_filter_n = state.tag_filter_n;
+  }
+}
+
+void Context::do_Series_TagTextColor( void )
+{
+  do_Color( &state.tag_text_color );
+  state.tag_colors = true;
+  if ( state.defining_series ) {
+    state.series_list.back()->TagTextColor()->Set( &state.tag_text_color );
+  }
+}
+
+void Context::do_Series_TagFillColor( void )
+{
+  do_Color( &state.tag_fill_color );
+  state.tag_colors = true;
+  if ( state.defining_series ) {
+    state.series_list.back()->TagFillColor()->Set( &state.tag_fill_color );
+  }
+}
+
+void Context::do_Series_TagLineColor( void )
+{
+  do_Color( &state.tag_line_color );
+  state.tag_colors = true;
+  if ( state.defining_series ) {
+    state.series_list.back()->TagLineColor()->Set( &state.tag_line_color );
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void Context::parse_series_data( bool anonymous_snap )
+{
+  state.defining_series = false;
+
+  uint32_t y_values = 0;
+  uint32_t rows = 0;
+  bool no_x_value = false;
+
+  // Do a pre-scan of all the data. Under a deadline the parse throughput is
+  // sampled over the first data rows of the input (see sample_throughput).
+  {
+    save_line_pos();
+    cur_col = 0;
+    bool x_is_text = false;
+    bool sampling = deadline_ms > 0 && point_rate == 0;
+    auto sample_start = std::chrono::steady_clock::now();
+    auto sample_end = [&]( void )
+    {
+      sample_ms +=
+        std::chrono::duration< double, std::milli >(
+          std::chrono::steady_clock::now() - sample_start
+        ).count();
+    };
+    // The X-values of rows which may be skipped are only checked to start like
+    // a number.
+    auto skip_number = [&]( void )
+    {
+      size_t col = cur_col;
+      const auto& line = cur_line->line;
+      if ( line[ col ] == '-' || line[ col ] == '+' ) col++;
+      if (
+        col == line.size() ||
+        !((line[ col ] >= '0' && line[ col ] <= '9') || line[ col ] == '.')
+      ) {
+        return false;
+      }
+      while ( !at_eol() && !at_ws() ) cur_col++;
+      return true;
+    };
+    while ( !at_eof() ) {
+      skip_ws( true );
+      if ( at_eol() ) break;
+      double d;
+      bool got_number = false;
+      if ( !x_is_text ) {
+        if ( rows % row_stride != 0 && skip_number() ) {
+          got_number = true;
+        } else if ( get_double( d ) ) {
+          got_number = at_eol() || at_ws();
+        }
+        if ( !got_number ) cur_col = id_col;
+      }
+      if ( !got_number ) {
+        std::string_view t;
+        bool quoted;
+        if ( !get_category( t, quoted ) ) {
+          parse_err( "unmatched quote", true );
+        }
+        if ( !quoted && !t.empty() && id_col == 0 ) {
+          if ( t.back() == ':' ) break;
+          auto save_col = cur_col;
+          skip_ws();
+          if ( get_char() == ':' ) break;
+          cur_col = save_col;
+        }
+        x_is_text = true;
+      }
+      if ( !at_eol() && !at_ws() ) {
+        parse_err( "syntax error" );
+      }
+      ++rows;
+      uint32_t n = 0;
+      while ( at_ws() ) {
+        skip_ws();
+        if ( at_eol() ) break;
+        while ( !at_eol() && !at_ws() ) cur_col++;
+        ++n;
+      }
+      y_values = std::max( y_values, n );
+      expect_eol();
+      if ( sampling && ++sample_rows == deadline_sample ) {
+        sample_end();
+        sample_throughput( y_values );
+        sampling = false;
+      }
+    }
+    if ( sampling ) sample_end();
+    if ( rows == 0 ) {
+      cur_col = 0;
+      return;
+    }
+    if ( state.series_type_defined ) {
+      if (
+        !x_is_text && y_values == 0 &&
+        state.series_type != Chart::SeriesType::XY &&
+        state.series_type != Chart::SeriesType::Scatter
+      ) {
+        no_x_value = true;
+      }
+    } else {
+      if ( !x_is_text ) {
+        no_x_value = true;
+        ++y_values;
+      }
+      state.series_type = Chart::SeriesType::Line;
+      state.series_type_defined = true;
+    }
+    if ( y_values == 0 ) y_values = 1;
+    restore_line_pos();
+  }
+
+  // Select the Y-value columns given by Series.Columns; slot_of gives the
+  // series index within the data block for each column, or -1 if the column
+  // is skipped.
+  uint32_t fields = y_values;
+  std::vector< int32_t > slot_of;
+  if ( !state.columns.empty() ) {
+    fields = 0;
+    for ( auto c : state.columns ) {
+      if ( c > y_values ) {
+        cur_col = 0;
+        parse_err(
+          "column " + std::to_string( c ) +
+          " selected by Series.Columns not present in data"
+        );
+      }
+      fields = std::max( fields, c );
+    }
+    slot_of.assign( fields, -1 );
+    for ( uint32_t i = 0; i < state.columns.size(); i++ ) {
+      slot_of[ state.columns[ i ] - 1 ] = i;
+    }
+    y_values = state.columns.size();
+  }
+
+  // Auto-add new series if needed.
+  for ( uint32_t i = 0; i < y_values; i++ ) {
+    if (
+      state.series_list.size() == i ||
+      state.data_list[ state.data_list.size() - i - 1 ]->Size() > 0
+    )
+      AddSeries( "", anonymous_snap );
+  }
+
+  // Detect series types.
+  bool x_is_num = false;
+  bool x_is_txt = false;
+  for ( uint32_t i = 0; i < y_values; i++ ) {
+    auto t = state.type_list[ state.type_list.size() - i - 1 ];
+    if (
+      t == Chart::SeriesType::XY ||
+      t == Chart::SeriesType::Scatter
+    )
+      x_is_num = true;
+    else
+      x_is_txt = true;
+  }
+  if ( x_is_num && x_is_txt ) {
+    parse_err( "cannot mix XY/Scatter series types with other series types" );
+  }
+
+  // Series clipped at ingest (see Series.Clip).
+  std::vector< ClipIngest > clip( y_values );
+  std::vector< bool > clipped( y_values, false );
+  if ( x_is_num ) {
+    for ( uint32_t n = 0; n < y_values; ++n ) {
+      auto sd = state.data_list[ state.series_list.size() - y_values + n ];
+      clipped[ n ] = sd->clip_ingest && clip_window( *sd, clip[ n ].window );
+      clip[ n ].scatter = sd->type == Chart::SeriesType::Scatter;
+    }
+  }
+
+  // The series of this data block share a single X column, except for series
+  // already holding data and clipped series. The pre-scan gives the exact
+  // number of data points to come; clipped series are left to grow as needed
+  // since they will likely only hold a small part.
+  bool single = true;
+  bool any_single = false;
+  bool unclipped = false;
+  for ( uint32_t n = 0; n < y_values; ++n ) {
+    auto sd = state.data_list[ state.series_list.size() - y_values + n ];
+    single = single && sd->SinglePrecision();
+    any_single = any_single || sd->SinglePrecision();
+    unclipped = unclipped || !clipped[ n ];
+  }
+  // Rows of XY and Scatter data may be skipped to meet a deadline.
+  const uint64_t stride = x_is_num ? row_stride : 1;
+  const size_t kept_rows = (rows + stride - 1) / stride;
+  std::shared_ptr< Column > x_col;
+  if ( unclipped ) {
+    x_col = std::make_shared< Column >( single );
+    x_col->reserve( kept_rows );
+  }
+  for ( uint32_t n = 0; n < y_values; ++n ) {
+    auto sd = state.data_list[ state.series_list.size() - y_values + n ];
+    if ( clipped[ n ] ) continue;
+    if (
+      sd->Size() == 0 && sd->borrowed.empty() &&
+      sd->SinglePrecision() == single
+    ) {
+      sd->ShareX( x_col );
+    }
+    sd->Reserve( sd->Size() + kept_rows );
+  }
+
+  std::string_view category;
+  std::string_view tag_x;
+  auto& categories = chart_info[ CurChart() ].categories;
+  for ( uint32_t row = 0; row < rows; row++ ) {
+    skip_ws( true );
+    if ( row % stride != 0 ) {
+      if ( !rows_skipped ) {
+        rows_skipped = true;
+        degradations.push_back(
+          "only one in every " + std::to_string( stride ) +
+          " data rows of XY and Scatter series parsed"
+        );
+      }
+      cur_col = cur_line->line.size();
+      continue;
+    }
+    id_col = cur_col;
+    if ( at_eol() ) parse_err( "X-value expected" );
+    double x;
+    if ( x_is_txt ) {
+      if ( !no_x_value ) {
+        bool quoted;
+        if ( !get_category( category, quoted ) ) {
+          parse_err( "unmatched quote", true );
+        }
+      }
+      categories.push_back( category_dict.Intern( category ) );
+      x = state.category_idx;
+      state.category_idx++;
+    } else {
+      if ( !get_double( x, true ) ) parse_err( "malformed X-value" );
+    }
+    if ( !no_x_value && !at_eol() && !at_ws() ) {
+      parse_err( "syntax error" );
+    }
+    if ( any_single && !Column::FitsFloat( x ) ) {
+      parse_err( "number too big for Float precision", true );
+    }
+    if ( x_col ) x_col->push_back( x );
+    tag_x =
+      std::string_view(
+        cur_line->line
+      ).substr( id_col, cur_col - id_col );
+    for ( uint32_t f = 0; f < fields; ++f ) {
+      skip_ws();
+      if ( !slot_of.empty() && slot_of[ f ] < 0 ) {
+        while ( !at_eol() && !at_ws() ) cur_col++;
+        continue;
+      }
+      uint32_t n = slot_of.empty() ? f : slot_of[ f ];
+      uint32_t series_idx = state.series_list.size() - y_values + n;
+      auto sd = state.data_list[ series_idx ];
+      double y;
+      if ( at_eol() && x_is_txt ) {
+        y = Chart::num_skip;
+        if ( sd->SharesX( x_col ) ) {
+          sd->AddY( y );
+        } else {
+          sd->Add( x, y );
+        }
+      } else {
+        if ( at_eol() ) parse_err( "Y-value expected" );
+        if ( !get_double( y, true ) ) parse_err( "malformed Y-value" );
+        if ( !at_eol() && !at_ws() ) parse_err( "syntax error" );
+        if ( sd->SinglePrecision() && !Column::FitsFloat( y ) ) {
+          parse_err( "number too big for Float precision", true );
+        }
+        std::string_view tag_y =
+          std::string_view(
+            cur_line->line
+          ).substr( id_col, cur_col - id_col );
+        if ( clipped[ n ] ) {
+          clip[ n ].Add( *sd, x, y, tag_x, tag_y );
+        } else if ( sd->SharesX( x_col ) ) {
+          sd->AddY( y, tag_x, tag_y );
+        } else {
+          sd->Add( x, y, tag_x, tag_y );
+        }
+      }
+    }
+    // Skip any columns after the last selected one.
+    if ( !slot_of.empty() ) {
+      while ( at_ws() ) {
+        skip_ws();
+        while ( !at_eol() && !at_ws() ) cur_col++;
+      }
+    }
+    expect_eol();
+  }
+  for ( uint32_t n = 0; n < y_values; ++n ) {
+    uint32_t series_idx = state.series_list.size() - y_values + n;
+    if ( clipped[ n ] ) clip[ n ].Flush( *state.data_list[ series_idx ] );
+  }
+
+  return;
+}
+
+//------------------------------------------------------------------------------
+
+void Context::do_Series_Contour( void )
+{
+  state.contour_levels.clear();
+  skip_ws();
+  while ( !at_eol() ) {
+    double level;
+    if ( !get_double( level ) ) parse_err( "malformed contour level" );
+    state.contour_levels.push_back( level );
+    skip_ws();
+  }
+  expect_eol();
+}
+
+void Context::do_Series_ContourGrid( void )
+{
+  skip_ws();
+  if ( at_eol() ) parse_err( "X-origin expected" );
+  if ( !get_double( state.contour_x0 ) ) parse_err( "malformed X-origin" );
+  expect_ws( "Y-origin expected" );
+  if ( !get_double( state.contour_y0 ) ) parse_err( "malformed Y-origin" );
+  expect_ws( "X-spacing expected" );
+  if ( !get_double( state.contour_dx ) ) parse_err( "malformed X-spacing" );
+  if ( state.contour_dx == 0 ) parse_err( "X-spacing cannot be zero", true );
+  expect_ws( "Y-spacing expected" );
+  if ( !get_double( state.contour_dy ) ) parse_err( "malformed Y-spacing" );
+  if ( state.contour_dy == 0 ) parse_err( "Y-spacing cannot be zero", true );
+  expect_eol();
+}
+
+// Trace the iso-lines of a gridded field using marching squares, adding the
+// iso-lines of each level to the corresponding series. Every iso-line point
+// lies on a grid edge, which is identified by a unique ID; horizontal edges
+// have even IDs and vertical edges have odd IDs. The cells are processed in
+// parallel row bands, each thread handling all levels for its band, after
+// which the segments of each level are chained into polylines by joining
+// segments sharing an edge.
+void Context::trace_contours(
+  const std::vector< SeriesData* >& sds, const std::vector< double >& levels,
+  const std::vector< double >& field, size_t rows, size_t cols
+)
+{
+  struct Segment {
+    uint64_t e0;
+    uint64_t e1;
+  };
+
+  auto val = [&]( size_t r, size_t c ) { return field[ r * cols + c ]; };
+  auto missing = [&]( double v )
+  {
+    return v == Chart::num_skip || v == Chart::num_invalid;
+  };
+  auto h_edge = [&]( size_t r, size_t c ) { return 2 * (r * cols + c) + 0; };
+  auto v_edge = [&]( size_t r, size_t c ) { return 2 * (r * cols + c) + 1; };
+
+  auto march = [&](
+    double level, size_t r_beg, size_t r_end, std::vector< Segment >& segs
+  )
+  {
+    for ( size_t r = r_beg; r < r_end; r++ ) {
+      for ( size_t c = 0; c + 1 < cols; c++ ) {
+        double tl = val( r    , c     );
+        double tr = val( r    , c + 1 );
+        double br = val( r + 1, c + 1 );
+        double bl = val( r + 1, c     );
+        if (
+          missing( tl ) || missing( tr ) || missing( br ) || missing( bl )
+        ) {
+          continue;
+        }
+        uint32_t idx =
+          ((tl >= level) ? 1 : 0) | ((tr >= level) ? 2 : 0) |
+          ((br >= level) ? 4 : 0) | ((bl >= level) ? 8 : 0);
+        if ( idx == 0 || idx == 15 ) continue;
+        uint64_t e[ 4 ] = {
+          h_edge( r, c ), v_edge( r, c + 1 ), h_edge( r + 1, c ), v_edge( r, c )
+        };
+        bool center = (tl + tr + br + bl) / 4 >= level;
+        auto add = [&]( int a, int b )
+        {
+          segs.push_back( { e[ a ], e[ b ] } );
+        };
+        switch ( idx ) {
+          case  1: case 14: add( 3, 0 ); break;
+          case  2: case 13: add( 0, 1 ); break;
+          case  3: case 12: add( 3, 1 ); break;
+          case  4: case 11: add( 1, 2 ); break;
+          case  6: case  9: add( 0, 2 ); break;
+          case  7: case  8: add( 3, 2 ); break;
+          case  5:
+            if ( center ) { add( 0, 1 ); add( 2, 3 ); }
+                     else { add( 3, 0 ); add( 1, 2 ); }
+            break;
+          case 10:
+            if ( center ) { add( 3, 0 ); add( 1, 2 ); }
+                     else { add( 0, 1 ); add( 2, 3 ); }
+            break;
+        }
+      }
+    }
+  };
+
+  // There are no more bands than rows of cells, and a single band is done
+  // without starting a thread.
+  const size_t nl = levels.size();
+  const size_t bands =
+    std::min< size_t >(
+      rows - 1, std::max( 1u, std::thread::hardware_concurrency() )
+    );
+  const size_t band_rows = (rows - 1 + bands - 1) / bands;
+  std::vector< std::vector< Segment > > band_segs( bands * nl );
+  auto march_band = [&]( size_t b )
+  {
+    size_t r_beg = std::min( rows - 1, b * band_rows );
+    size_t r_end = std::min( rows - 1, r_beg + band_rows );
+    for ( size_t l = 0; l < nl; l++ ) {
+      march( levels[ l ], r_beg, r_end, band_segs[ l * bands + b ] );
+    }
+  };
+  if ( bands == 1 ) {
+    march_band( 0 );
+  } else {
+    std::vector< std::thread > workers;
+    for ( size_t b = 0; b < bands; b++ ) workers.emplace_back( march_band, b );
+    for ( auto& w : workers ) w.join();
+  }
+
+  for ( size_t l = 0; l < nl; l++ ) {
+    SeriesData* sd = sds[ l ];
+    const double level = levels[ l ];
+    std::vector< Segment > segs;
+    for ( size_t b = 0; b < bands; b++ ) {
+      auto& bs = band_segs[ l * bands + b ];
+      segs.insert( segs.end(), bs.begin(), bs.end() );
+      bs = {};
+    }
+
+    // An edge is shared by at most two segments.
+    const uint32_t none = UINT32_MAX;
+    std::unordered_map< uint64_t, std::pair< uint32_t, uint32_t > > edge_segs;
+    edge_segs.reserve( segs.size() * 2 );
+    for ( uint32_t i = 0; i < segs.size(); i++ ) {
+      for ( uint64_t e : { segs[ i ].e0, segs[ i ].e1 } ) {
+        auto it = edge_segs.find( e );
+        if ( it == edge_segs.end() ) {
+          edge_segs[ e ] = { i, none };
+        } else {
+          it->second.second = i;
+        }
+      }
+    }
+
+    auto add_point = [&]( uint64_t e )
+    {
+      size_t n = e / 2;
+      size_t r = n / cols;
+      size_t c = n % cols;
+      size_t r2 = r + ((e & 1) ? 1 : 0);
+      size_t c2 = c + ((e & 1) ? 0 : 1);
+      double v1 = val( r, c );
+      double v2 = val( r2, c2 );
+      double t = (v1 == v2) ? 0.5 : (level - v1) / (v2 - v1);
+      double fr = r + t * (r2 - r);
+      double fc = c + t * (c2 - c);
+      sd->Add(
+        state.contour_x0 + fc * state.contour_dx,
+        state.contour_y0 + fr * state.contour_dy
+      );
+    };
+
+    std::vector< bool > done( segs.size(), false );
+    auto follow = [&]( uint32_t i, uint64_t e )
+    {
+      add_point( e );
+      while ( i != none && !done[ i ] ) {
+        done[ i ] = true;
+        e = (segs[ i ].e0 == e) ? segs[ i ].e1 : segs[ i ].e0;
+        add_point( e );
+        auto& p = edge_segs[ e ];
+        i = (p.first == i) ? p.second : p.first;
+      }
+      sd->Add( sd->X( sd->Size() - 1 ), Chart::num_invalid );
+    };
+
+    // Open polylines start at an edge with a single segment; what remains are
+    // closed loops.
+    for ( auto& es : edge_segs ) {
+      if ( es.second.second == none && !done[ es.second.first ] ) {
+        follow( es.second.first, es.first );
+      }
+    }
+    for ( uint32_t i = 0; i < segs.size(); i++ ) {
+      if ( !done[ i ] ) follow( i, segs[ i ].e0 );
+    }
+  }
+}
+
+// Parse a matrix of values and add one series per contour level.
+void Context::parse_contour_data( void )
+{
+  state.defining_series = false;
+
+  std::vector< double > field;
+  size_t rows = 0;
+  size_t cols = 0;
+  double min = 0;
+  double max = 0;
+  bool got_value = false;
+  while ( true ) {
+    skip_ws( true );
+    if ( at_eof() || cur_col == 0 ) break;
+    size_t n = 0;
+    while ( !at_eol() ) {
+      double d;
+      if ( !get_double( d, true ) ) parse_err( "malformed matrix value" );
+      if ( d != Chart::num_skip && d != Chart::num_invalid ) {
+        if ( !got_value || d < min ) min = d;
+        if ( !got_value || d > max ) max = d;
+        got_value = true;
+      }
+      field.push_back( d );
+      n++;
+      skip_ws();
+    }
+    if ( rows > 0 && n != cols ) parse_err( "matrix row length mismatch" );
+    cols = n;
+    rows++;
+  }
+  if ( rows < 2 || cols < 2 ) {
+    parse_err( "matrix must be at least 2 by 2" );
+  }
+
+  std::vector< double > levels = state.contour_levels;
+  if ( levels.empty() ) {
+    for ( int i = 1; i <= 10; i++ ) {
+      levels.push_back( min + (max - min) * i / 11 );
+    }
+  }
+
+  // Use the empty contour series defined beforehand for this chart and
+  // auto-add new series as needed.
+  uint32_t n = levels.size();
+  uint32_t defined = 0;
+  auto reusable = [&]( const SeriesData* sd )
+  {
+    return
+      sd->contour && sd->chart == CurChart() &&
+      sd->Size() == 0 && sd->borrowed.empty();
+  };
+  while (
+    defined < n && defined < state.data_list.size() &&
+    reusable( state.data_list[ state.data_list.size() - defined - 1 ] )
+  ) {
+    defined++;
+  }
+  for ( uint32_t i = defined; i < n; i++ ) {
+    std::ostringstream oss;
+    oss << levels[ i ];
+    AddSeries( oss.str() );
+  }
+  std::vector< SeriesData* > sds(
+    state.data_list.end() - n, state.data_list.end()
+  );
+  double x1 = state.contour_x0 + (cols - 1) * state.contour_dx;
+  double y1 = state.contour_y0 + (rows - 1) * state.contour_dy;
+  for ( auto sd : sds ) {
+    if (
+      sd->SinglePrecision() && (
+        !Column::FitsFloat( state.contour_x0 ) || !Column::FitsFloat( x1 ) ||
+        !Column::FitsFloat( state.contour_y0 ) || !Column::FitsFloat( y1 )
+      )
+    ) {
+      cur_col = 0;
+      parse_err( "contour grid too big for Float precision" );
+    }
+  }
+  trace_contours( sds, levels, field, rows, cols );
+}
+
+void Context::do_Series_Data( void )
+{
+  expect_eol();
+  next_line();
+  if ( state.contour ) {
+    parse_contour_data();
+  } else {
+    parse_series_data();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::unordered_map< std::string, Context::ChartAction >
+Context::chart_actions = {
+  { "Margin"                 , &Context::do_Margin                  },
+  { "BorderColor"            , &Context::do_BorderColor             },
+  { "BorderWidth"            , &Context::do_BorderWidth             },
+  { "Padding"                , &Context::do_Padding                 },
+  { "GridPadding"            , &Context::do_GridPadding             },
+  { "GlobalLegendHeading"    , &Context::do_GlobalLegendHeading     },
+  { "GlobalLegendFrame"      , &Context::do_GlobalLegendFrame       },
+  { "GlobalLegendPos"        , &Context::do_GlobalLegendPos         },
+  { "GlobalLegendSize"       , &Context::do_GlobalLegendSize        },
+  { "GlobalLegendColor"      , &Context::do_GlobalLegendColor       },
+  { "LetterSpacing"          , &Context::do_LetterSpacing           },
+  { "New"                    , &Context::do_New                     },
+  { "ChartArea"              , &Context::do_ChartArea               },
+  { "ChartBox"               , &Context::do_ChartBox                },
+  { "ForegroundColor"        , &Context::do_ForegroundColor         },
+  { "BackgroundColor"        , &Context::do_BackgroundColor         },
+  { "ChartAreaColor"         , &Context::do_ChartAreaColor          },
+  { "AxisColor"              , &Context::do_AxisColor               },
+  { "GridColor"              , &Context::do_GridColor               },
+  { "TextColor"              , &Context::do_TextColor               },
+  { "FrameColor"             , &Context::do_FrameColor              },
+  { "GlobalTitle"            , &Context::do_GlobalTitle             },
+  { "GlobalSubTitle"         , &Context::do_GlobalSubTitle          },
+  { "GlobalSubSubTitle"      , &Context::do_GlobalSubSubTitle       },
+  { "GlobalTitlePos"         , &Context::do_GlobalTitlePos          },
+  { "GlobalTitleSize"        , &Context::do_GlobalTitleSize         },
+  { "GlobalTitleLine"        , &Context::do_GlobalTitleLine         },
+  { "Title"                  , &Context::do_Title                   },
+  { "SubTitle"               , &Context::do_SubTitle                },
+  { "SubSubTitle"            , &Context::do_SubSubTitle             },
+  { "TitleFrame"             , &Context::do_TitleFrame              },
+  { "TitlePos"               , &Context::do_TitlePos                },
+  { "TitleInside"            , &Context::do_TitleInside             },
+  { "TitleSize"              , &Context::do_TitleSize               },
+  { "Footnote"               , &Context::do_Footnote                },
+  { "FootnotePos"            , &Context::do_FootnotePos             },
+  { "FootnoteSize"           , &Context::do_FootnoteSize            },
+  { "FootnoteLine"           , &Context::do_FootnoteLine            },
+  { "LegendHeading"          , &Context::do_LegendHeading           },
+  { "LegendFrame"            , &Context::do_LegendFrame             },
+  { "LegendPos"              , &Context::do_LegendPos               },
+  { "LegendSize"             , &Context::do_LegendSize              },
+  { "BarWidth"               , &Context::do_BarWidth                },
+  { "LayeredBarWidth"        , &Context::do_LayeredBarWidth         },
+  { "BarMargin"              , &Context::do_BarMargin               },
+  { "Series.Type"            , &Context::do_Series_Type             },
+  { "Series.New"             , &Context::do_Series_New              },
+  { "Series.Prune"           , &Context::do_Series_Prune            },
+  { "Series.Raster"          , &Context::do_Series_Raster           },
+  { "Series.Precision"       , &Context::do_Series_Precision        },
+  { "Series.Clip"            , &Context::do_Series_Clip             },
+  { "Series.Columns"         , &Context::do_Series_Columns          },
+  { "Series.GlobalLegend"    , &Context::do_Series_GlobalLegend     },
+  { "Series.LegendOutline"   , &Context::do_Series_LegendOutline    },
+  { "Series.Axis"            , &Context::do_Series_Axis             },
+  { "Series.Base"            , &Context::do_Series_Base             },
+  { "Series.Style"           , &Context::do_Series_Style            },
+  { "Series.MarkerShape"     , &Context::do_Series_MarkerShape      },
+  { "Series.MarkerSize"      , &Context::do_Series_MarkerSize       },
+  { "Series.LineWidth"       , &Context::do_Series_LineWidth        },
+  { "Series.LineDash"        , &Context::do_Series_LineDash         },
+  { "Series.Lighten"         , &Context::do_Series_Lighten          },
+  { "Series.FillTransparency", &Context::do_Series_FillTransparency },
+  { "Series.LineColor"       , &Context::do_Series_LineColor        },
+  { "Series.FillColor"       , &Context::do_Series_FillColor        },
+  { "Series.Tag"             , &Context::do_Series_Tag              },
+  { "Series.TagPos"          , &Context::do_Series_TagPos           },
+  { "Series.TagSize"         , &Context::do_Series_TagSize          },
+  { "Series.TagBox"          , &Context::do_Series_TagBox           },
+  { "Series.TagOverlap"      , &Context::do_Series_TagOverlap       },
+  { "Series.TagFilter"       , &Context::do_Series_TagFilter        },
+  { "Series.TagTextColor"    , &Context::do_Series_TagTextColor     },
+  { "Series.TagFillColor"    , &Context::do_Series_TagFillColor     },
+  { "Series.TagLineColor"    , &Context::do_Series_TagLineColor     },
+  { "Series.Contour"         , &Context::do_Series_Contour          },
+  { "Series.ContourGrid"     , &Context::do_Series_ContourGrid      },
+  { "Series.Data"            , &Context::do_Series_Data             },
+};
+
+const std::unordered_map< std::string, Context::AxisAction >
+Context::axis_actions = {
+  { "Orientation" , &Context::do_Axis_Orientation  },
+  { "Reverse"     , &Context::do_Axis_Reverse      },
+  { "Style"       , &Context::do_Axis_Style        },
+  { "Label"       , &Context::do_Axis_Label        },
+  { "SubLabel"    , &Context::do_Axis_SubLabel     },
+  { "LabelSize"   , &Context::do_Axis_LabelSize    },
+  { "Unit"        , &Context::do_Axis_Unit         },
+  { "UnitPos"     , &Context::do_Axis_UnitPos      },
+  { "LogScale"    , &Context::do_Axis_LogScale     },
+  { "Range"       , &Context::do_Axis_Range        },
+  { "Pos"         , &Context::do_Axis_Pos          },
+  { "Tick"        , &Context::do_Axis_Tick         },
+  { "TickSpacing" , &Context::do_Axis_TickSpacing  },
+  { "Grid"        , &Context::do_Axis_Grid         },
+  { "GridStyle"   , &Context::do_Axis_GridStyle    },
+  { "GridColor"   , &Context::do_Axis_GridColor    },
+  { "NumberFormat", &Context::do_Axis_NumberFormat },
+  { "NumberSign"  , &Context::do_Axis_NumberSign   },
+  { "NumberUnit"  , &Context::do_Axis_NumberUnit   },
+  { "MinorNumber" , &Context::do_Axis_MinorNumber  },
+  { "NumberPos"   , &Context::do_Axis_NumberPos    },
+  { "NumberSize"  , &Context::do_Axis_NumberSize   },
+};
+
+bool Context::parse_spec( void )
+{
+  std::string key;
+  if ( !get_key( key ) ) return false;
+
+  bool ok = false;
+
+  do {
+    if ( key.substr( 0, 5 ) == "Axis." ) {
+      size_t i = key.find( '.', 5 );
+      if ( i == std::string::npos ) break;
+      std::string axis_id = key.substr( 5, i - 5 );
+      Chart::Axis* axis = nullptr;
+      if ( axis_id == "X"    ) axis = CurChart()->AxisX(   ); else
+      if ( axis_id == "Y"    ) axis = CurChart()->AxisY(   ); else
+      if ( axis_id == "Y1"   ) axis = CurChart()->AxisY( 0 ); else
+      if ( axis_id == "PriY" ) axis = CurChart()->AxisY( 0 ); else
+      if ( axis_id == "Y2"   ) axis = CurChart()->AxisY( 1 ); else
+      if ( axis_id == "SecY" ) axis = CurChart()->AxisY( 1 ); else
+      break;
+      auto it = axis_actions.find( key.substr( i + 1 ) );
+      if ( it == axis_actions.end() ) break;
+      (this->*it->second)( axis );
+      ok = true;
+    } else {
+      auto it = chart_actions.find( key );
+      if ( it == chart_actions.end() ) break;
+      (this->*it->second)();
+      ok = true;
+    }
+  } while ( false );
+
+  if ( !ok ) parse_err( "unknown KEY '" + key + "'", true );
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::parse_lines( void )
+{
+  cur_line = lines.begin();
+  while ( cur_line != lines.end() && cur_line->macro ) {
+    ++cur_line;
+  }
+  cur_col = 0;
+
+  // Support delivering nothing but data (implicit Series.Data).
+  parse_series_data( true );
+
+  while ( parse_spec() ) {}
+}
+
+//------------------------------------------------------------------------------
+
+// The input lines are often the largest allocation, so they are released once
+// parsed, along with the file names and macros. The category and tag texts
+// that are views into the lines are first copied to a compact pool. The X-value
+// tags are shared by all the series of a data block, and are therefore copied
+// only once.
+void Context::release_input( void )
+{
+  category_dict.MoveTexts( kept_text );
+  std::unordered_map< const char*, std::string_view > moved;
+  for ( auto& sd : series_data ) {
+    if ( !sd.HasTags() ) continue;
+    for ( size_t i = 0; i < sd.Size(); i++ ) {
+      std::string_view& tx = sd.tag_x[ i ];
+      if ( !tx.empty() ) {
+        auto it = moved.find( tx.data() );
+        if ( it == moved.end() ) {
+          it = moved.emplace( tx.data(), kept_text.Store( tx ) ).first;
+        }
+        tx = it->second;
+      }
+      sd.tag_y[ i ] = kept_text.Store( sd.tag_y[ i ] );
+    }
+  }
+
+  std::vector< LineRec >().swap( lines );
+  line_text = TextArena();
+  cur_line = lines.end();
+  cur_col = 0;
+  file_names.clear();
+  macros.clear();
+  std::vector< LineRecIter >().swap( macro_stack );
+  for ( auto& s : saved_macro_stack ) std::vector< LineRecIter >().swap( s );
+  for ( auto& l : saved_line ) l = lines.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// The size of one target pixel in points. The widest chart area is used as an
+// approximation of the SVG width, which errs on the side of smaller pixels.
+double Context::pixel_size( void )
+{
+  if ( target_width == 0 ) return 1.0;
+  int64_t width = 0;
+  for ( auto& sd : series_data ) {
+    width = std::max( width, chart_info[ sd.chart ].area_w );
+  }
+  if ( width == 0 ) width = ChartInfo().area_w;
+  return static_cast< double >( width ) / target_width;
+}
+
+bool is_reducible( const SeriesData& sd )
+{
+  return
+    sd.type == Chart::SeriesType::XY ||
+    sd.type == Chart::SeriesType::Scatter;
+}
+
+//------------------------------------------------------------------------------
+
+// Find the window given by Axis.*.Range for the series, widened by clip_margin
+// points on all sides to allow for markers and line widths extending into the
+// chart area. A log axis with a range starting at or below zero is unbounded.
+// Returns false if neither axis of the series has a range.
+bool Context::clip_window( const SeriesData& sd, ClipWindow& window )
+{
+  const ChartInfo& info = chart_info[ sd.chart ];
+  window.x_range = info.x_range;
+  window.y_range = info.y_range[ sd.axis_y_n ];
+  if ( !window.x_range && !window.y_range ) return false;
+
+  const double clip_margin = 32;
+  const double w = info.x_vertical ? info.area_h : info.area_w;
+  const double h = info.x_vertical ? info.area_w : info.area_h;
+  auto expand = [&]( double& lo, double& hi, bool log, double extent )
+  {
+    if ( log && !(lo > 0) ) {
+      lo = -std::numeric_limits< double >::infinity();
+      hi = +std::numeric_limits< double >::infinity();
+      return;
+    }
+    if ( log ) {
+      double m = (std::log10( hi ) - std::log10( lo )) * clip_margin / extent;
+      lo = std::pow( 10.0, std::log10( lo ) - m );
+      hi = std::pow( 10.0, std::log10( hi ) + m );
+    } else {
+      double m = (hi - lo) * clip_margin / extent;
+      lo -= m;
+      hi += m;
+    }
+  };
+  window.x_lo = info.x_min;
+  window.x_hi = info.x_max;
+  window.y_lo = info.y_min[ sd.axis_y_n ];
+  window.y_hi = info.y_max[ sd.axis_y_n ];
+  expand( window.x_lo, window.x_hi, info.x_log, w );
+  expand( window.y_lo, window.y_hi, info.y_log[ sd.axis_y_n ], h );
+  return true;
+}
+
+// Drop the data points of an XY or Scatter series which cannot be seen because
+// they are outside the window found by clip_window. Ascending X-values are
+// handled by a binary search for the visible window. Otherwise each point is
+// given a clip code, and for XY the points of line segments that are entirely
+// on the outside of one of the range limits are dropped, leaving a line break
+// in their place.
+void Context::clip_to_range( SeriesData& sd )
+{
+  if ( !is_reducible( sd ) || sd.Size() == 0 ) return;
+  ClipWindow window;
+  if ( !clip_window( sd, window ) ) return;
+  const bool x_range = window.x_range;
+  const bool y_range = window.y_range;
+  const double x_lo = window.x_lo;
+  const double x_hi = window.x_hi;
+  const double y_lo = window.y_lo;
+  const double y_hi = window.y_hi;
+
+  std::vector< size_t > keep;
+
+  if ( x_range && sd.x_sorted ) {
+    size_t b = 0;
+    size_t e = sd.Size();
+    {
+      size_t l = 0;
+      size_t r = sd.Size();
+      while ( l < r ) {
+        size_t m = l + (r - l) / 2;
+        if ( sd.X( m ) < x_lo ) l = m + 1; else r = m;
+      }
+      b = l;
+      r = sd.Size();
+      while ( l < r ) {
+        size_t m = l + (r - l) / 2;
+        if ( sd.X( m ) > x_hi ) r = m; else l = m + 1;
+      }
+      e = l;
+    }
+    // For XY include one neighbour on each side, not counting skipped and
+    // invalid points, to get the lines into the visible window.
+    auto is_gap = [&]( size_t i )
+    {
+      return SeriesData::IsGap( sd.X( i ), sd.y[ i ] );
+    };
+    if ( sd.type == Chart::SeriesType::XY ) {
+      while ( b > 0 ) if ( !is_gap( --b ) ) break;
+      while ( e < sd.Size() ) if ( !is_gap( e++ ) ) break;
+    }
+    if ( b > 0 || e < sd.Size() ) {
+      for ( size_t i = b; i < e; i++ ) keep.push_back( i );
+      sd.Keep( keep );
+      keep.clear();
+    }
+    if ( !y_range ) return;
+  }
+
+  const uint8_t left = ClipWindow::left;
+  const uint8_t right = ClipWindow::right;
+  const uint8_t below = ClipWindow::below;
+  const uint8_t above = ClipWindow::above;
+  std::vector< uint8_t > codes( sd.Size(), 0 );
+  if ( x_range ) {
+    sd.x_col->ClipCodes( 0, sd.Size(), x_lo, x_hi, left, right, codes.data() );
+  }
+  if ( y_range ) {
+    sd.y.ClipCodes( 0, sd.Size(), y_lo, y_hi, below, above, codes.data() );
+  }
+
+  // Skipped and invalid points are kept as they do not count as outside.
+  bool dropped = false;
+  bool broken = false;
+  auto keep_gap = [&]( size_t i ) { keep.push_back( i ); };
+  if ( sd.type == Chart::SeriesType::Scatter ) {
+    sd.ForEachRun(
+      [&]( size_t b, size_t e )
+      {
+        for ( size_t i = b; i < e; i++ ) {
+          if ( codes[ i ] == 0 ) keep.push_back( i ); else dropped = true;
+        }
+      },
+      keep_gap
+    );
+  } else {
+    // The first and last point of each run are always kept as lines continue
+    // across skipped points.
+    sd.ForEachRun(
+      [&]( size_t b, size_t e )
+      {
+        bool in_break = false;
+        for ( size_t i = b; i < e; i++ ) {
+          bool visible =
+            i == b || i + 1 == e ||
+            (codes[ i ] & codes[ i - 1 ]) == 0 ||
+            (codes[ i ] & codes[ i + 1 ]) == 0;
+          if ( visible ) {
+            keep.push_back( i );
+            in_break = false;
+          } else {
+            dropped = true;
+            if ( !in_break ) {
+              sd.y.Set( i, Chart::num_invalid );
+              keep.push_back( i );
+              broken = true;
+            }
+            in_break = true;
+          }
+        }
+      },
+      keep_gap
+    );
+  }
+  if ( !dropped ) return;
+  sd.Keep( keep );
+  if ( broken ) sd.ScanGaps();
+}
+
+// Determine which data points to keep when reducing an XY or Scatter series to
+// a raster covering the chart area, where each raster cell is the given number
+// of points in size (see Series.Raster). For XY the first, last, lowest, and
+// highest point of each run of points falling in the same raster column are
+// kept, which leaves the drawn line unchanged to within one raster cell. For
+// Scatter one point is kept per occupied raster cell. The raster spans the
+// Axis.*.Range window if given, and otherwise the range of the data; points
+// outside the window, such as the neighbours kept by clip_to_range, are kept.
+void Context::raster_keep(
+  SeriesData& sd, double cell, std::vector< size_t >& keep
+)
+{
+  keep.clear();
+
+  const ChartInfo& info = chart_info[ sd.chart ];
+  const bool x_log = info.x_log;
+  const bool y_log = info.y_log[ sd.axis_y_n ];
+  const double w = info.x_vertical ? info.area_h : info.area_w;
+  const double h = info.x_vertical ? info.area_w : info.area_h;
+  const int64_t nx = std::max( 1.0, std::ceil( w / cell ) );
+  const int64_t ny = std::max( 1.0, std::ceil( h / cell ) );
+
+  // Skip and invalid values are given by the gap list of the series, so within
+  // the runs in between only log scale values must be checked.
+  auto log_ok = [&]( size_t i )
+  {
+    return (!x_log || sd.X( i ) > 0) && (!y_log || sd.y[ i ] > 0);
+  };
+  auto coord = [&]( double v, bool log )
+  {
+    return log ? std::log10( v ) : v;
+  };
+  auto no_gap = []( size_t ) {};
+
+  double x_min = 0, x_max = 0;
+  double y_min = 0, y_max = 0;
+  const bool x_window = info.x_range && (!x_log || info.x_min > 0);
+  const bool y_window =
+    info.y_range[ sd.axis_y_n ] && (!y_log || info.y_min[ sd.axis_y_n ] > 0);
+  bool first = true;
+  auto update = [&]( double x0, double x1, double y0, double y1 )
+  {
+    if ( first || x0 < x_min ) x_min = x0;
+    if ( first || x1 > x_max ) x_max = x1;
+    if ( first || y0 < y_min ) y_min = y0;
+    if ( first || y1 > y_max ) y_max = y1;
+    first = false;
+  };
+  if ( !x_window || !y_window ) {
+    sd.ForEachRun(
+      [&]( size_t b, size_t e )
+      {
+        double x0, x1, y0, y1;
+        sd.x_col->MinMax( b, e, x0, x1 );
+        sd.y.MinMax( b, e, y0, y1 );
+        // The log is monotonic, so the range can be found from the plain
+        // values when they can all be shown on the log scales.
+        if ( (!x_log || x0 > 0) && (!y_log || y0 > 0) ) {
+          update(
+            coord( x0, x_log ), coord( x1, x_log ),
+            coord( y0, y_log ), coord( y1, y_log )
+          );
+          return;
+        }
+        for ( size_t i = b; i < e; i++ ) {
+          if ( !log_ok( i ) ) continue;
+          double x = coord( sd.X( i ), x_log );
+          double y = coord( sd.y[ i ], y_log );
+          update( x, x, y, y );
+        }
+      },
+      no_gap
+    );
+  }
+  if ( x_window ) {
+    x_min = coord( info.x_min, x_log );
+    x_max = coord( info.x_max, x_log );
+  }
+  if ( y_window ) {
+    y_min = coord( info.y_min[ sd.axis_y_n ], y_log );
+    y_max = coord( info.y_max[ sd.axis_y_n ], y_log );
+  }
+
+  // Invalid data points are kept while skipped data points are dropped.
+  auto keep_gap = [&]( size_t i )
+  {
+    if ( sd.X( i ) != Chart::num_skip && sd.y[ i ] != Chart::num_skip ) {
+      keep.push_back( i );
+    }
+  };
+
+  // The runs are mapped to raster cells in chunks; a cell of -1 indicates a
+  // value outside the raster or one which cannot be shown on a log scale.
+  const size_t chunk = 4096;
+  std::vector< int64_t > cx( chunk );
+  std::vector< int64_t > cy( chunk );
+
+  if ( sd.type == Chart::SeriesType::Scatter ) {
+    std::unordered_set< int64_t > occupied;
+    sd.ForEachRun(
+      [&]( size_t b, size_t e )
+      {
+        for ( size_t c = b; c < e; c += chunk ) {
+          size_t ce = std::min( e, c + chunk );
+          sd.x_col->MapToCells( c, ce, x_log, x_min, x_max, nx, cx.data() );
+          sd.y.MapToCells( c, ce, y_log, y_min, y_max, ny, cy.data() );
+          for ( size_t i = c; i < ce; i++ ) {
+            int64_t x = cx[ i - c ];
+            int64_t y = cy[ i - c ];
+            if ( x < 0 || y < 0 ) {
+              keep.push_back( i );
+              continue;
+            }
+            if ( occupied.insert( x * ny + y ).second ) keep.push_back( i );
+          }
+        }
+      },
+      keep_gap
+    );
+  } else {
+    const size_t none = sd.Size();
+    size_t run_first = none;
+    size_t run_last = none;
+    size_t run_lo = none;
+    size_t run_hi = none;
+    int64_t run_col = 0;
+    auto end_run = [&]( void )
+    {
+      if ( run_first == none ) return;
+      size_t idx[ 4 ] = { run_first, run_lo, run_hi, run_last };
+      std::sort( idx, idx + 4 );
+      for ( size_t n = 0; n < 4; n++ ) {
+        if ( n == 0 || idx[ n ] != idx[ n - 1 ] ) keep.push_back( idx[ n ] );
+      }
+      run_first = none;
+    };
+    sd.ForEachRun(
+      [&]( size_t b, size_t e )
+      {
+        for ( size_t c = b; c < e; c += chunk ) {
+          size_t ce = std::min( e, c + chunk );
+          sd.x_col->MapToCells( c, ce, x_log, x_min, x_max, nx, cx.data() );
+          for ( size_t i = c; i < ce; i++ ) {
+            int64_t col = cx[ i - c ];
+            if ( col < 0 || (y_log && !(sd.y[ i ] > 0)) ) {
+              end_run();
+              keep.push_back( i );
+              continue;
+            }
+            if ( run_first != none && col != run_col ) end_run();
+            if ( run_first == none ) {
+              run_first = run_last = run_lo = run_hi = i;
+              run_col = col;
+            } else {
+              run_last = i;
+              if ( sd.y[ i ] < sd.y[ run_lo ] ) run_lo = i;
+              if ( sd.y[ i ] > sd.y[ run_hi ] ) run_hi = i;
+            }
+          }
+        }
+        end_run();
+      },
+      keep_gap
+    );
+  }
+}
+
+void Context::raster_reduce( SeriesData& sd, double cell )
+{
+  if ( !is_reducible( sd ) ) return;
+  std::vector< size_t > keep;
+  raster_keep( sd, cell, keep );
+  sd.Keep( keep );
+}
+
+//------------------------------------------------------------------------------
+
+// Rough estimate of the number of SVG bytes generated per data point.
+uint64_t bytes_per_point( Chart::SeriesType type )
+{
+  switch ( type ) {
+    case Chart::SeriesType::XY          :
+    case Chart::SeriesType::Line        :
+    case Chart::SeriesType::Area        :
+    case Chart::SeriesType::StackedArea :
+      return 16;
+    default:
+      return 80;
+  }
+}
+
+// Rough estimate of the number of SVG bytes not related to the data points.
+const uint64_t base_bytes = 16384;
+
+// Find the smallest raster cell size for which the series data fits within the
+// given limits (zero means no limit), using a bisection over the cell size. The
+// raster cell size is then applied to all reducible series, and their prune
+// distance is raised accordingly. Returns the chosen cell size, or zero if no
+// reduction was needed; met is set to false if the limits cannot be met even
+// with the coarsest raster.
+double Context::reduce_to_limits(
+  double min_cell, uint64_t elements_limit, uint64_t bytes_limit,
+  uint64_t& points_before, uint64_t& points_after, bool& met
+)
+{
+  std::vector< size_t > keep;
+  uint64_t fixed_points = 0;
+  uint64_t fixed_bytes = base_bytes;
+  for ( auto& sd : series_data ) {
+    if ( is_reducible( sd ) ) continue;
+    fixed_points += sd.Size();
+    fixed_bytes += sd.Size() * bytes_per_point( sd.type );
+  }
+
+  auto fits = [&]( double cell, uint64_t& points )
+  {
+    points = fixed_points;
+    uint64_t bytes = fixed_bytes;
+    for ( auto& sd : series_data ) {
+      if ( !is_reducible( sd ) ) continue;
+      size_t n = sd.Size();
+      if ( cell > 0 ) {
+        raster_keep( sd, cell, keep );
+        n = keep.size();
+      }
+      points += n;
+      bytes += n * bytes_per_point( sd.type );
+    }
+    return
+      (elements_limit == 0 || points <= elements_limit) &&
+      (bytes_limit    == 0 || bytes  <= bytes_limit   );
+  };
+
+  met = true;
+  if ( fits( 0, points_before ) ) {
+    points_after = points_before;
+    return 0;
+  }
+
+  double lo = min_cell;
+  double hi = 100000.0;
+  if ( !fits( hi, points_after ) ) {
+    met = false;
+    lo = hi;
+  }
+  if ( lo < hi && fits( lo, points_after ) ) hi = lo;
+  while ( hi / lo > 1.01 ) {
+    double mid = std::sqrt( lo * hi );
+    if ( fits( mid, points_after ) ) hi = mid; else lo = mid;
+  }
+  fits( hi, points_after );
+
+  for ( auto& sd : series_data ) {
+    if ( !is_reducible( sd ) ) continue;
+    raster_reduce( sd, hi );
+    sd.prune_dist = std::max( sd.prune_dist, hi );
+    sd.series->SetPruneDist( sd.prune_dist );
+  }
+
+  return hi;
+}
+
+void Context::apply_output_budget( double min_cell )
+{
+  if ( max_bytes == 0 && max_elements == 0 ) return;
+
+  uint64_t points_before;
+  uint64_t points_after;
+  bool met;
+  double cell =
+    reduce_to_limits(
+      min_cell, max_elements, max_bytes, points_before, points_after, met
+    );
+  if ( !met ) {
+    uint64_t bytes = base_bytes;
+    for ( auto& sd : series_data ) {
+      bytes += sd.Size() * bytes_per_point( sd.type );
+    }
+    std::cerr
+      << "*** WARNING: output budget cannot be met; the coarsest raster cell "
+      << "size and prune distance " << cell << " leaves " << points_after
+      << " data points (about " << bytes << " bytes)\n";
+  } else if ( cell == 0 ) {
+    std::cerr
+      << "*** NOTE: output budget met without reduction ("
+      << points_before << " data points)\n";
+  } else {
+    std::cerr
+      << "*** NOTE: output budget applied using raster cell size and prune "
+      << "distance " << cell << " (" << points_before << " -> "
+      << points_after << " data points)\n";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Rough relative cost of a tagged data point compared to an untagged one.
+const uint64_t tag_cost = 10;
+
+double Context::elapsed_ms( void ) const
+{
+  return
+    std::chrono::duration< double, std::milli >(
+      std::chrono::steady_clock::now() - start_time
+    ).count();
+}
+
+// Called once the parse throughput has been sampled over the pre-scan of the
+// first deadline_sample data rows, to choose how many rows of XY and Scatter
+// data to skip for the rest of the input. In units of pre-scanned rows, the
+// remaining lines are each estimated to cost one for the pre-scan, and one per
+// number for the parse and per data point for the build, except for skipped
+// rows, which only cost a fraction for the quick pre-scan. The data points
+// parsed so far need only be built.
+void Context::sample_throughput( uint32_t y_values )
+{
+  const double y = std::max( y_values, 1u );
+  const double skip_cost = 0.25;
+  point_rate = sample_rows / std::max( sample_ms, 1e-3 );
+
+  uint64_t parsed = 0;
+  for ( auto& sd : series_data ) parsed += sd.Size();
+  double remaining = std::max( 0.0, deadline_ms - elapsed_ms() );
+  double allowed = point_rate * remaining - parsed;
+  double lines_left = lines.end() - cur_line;
+  double full = lines_left * (2 + 2 * y);
+  if ( full <= allowed ) return;
+
+  double spare = allowed - lines_left * skip_cost;
+  row_stride = (spare < 1) ? lines.size() : std::ceil( full / spare );
+}
+
+// Degrade the chart progressively until the remaining work is estimated to fit
+// within the deadline. The parse throughput sampled early on, or else measured
+// over all the input, is used as a yardstick, assuming that building and
+// serializing a data point costs about as much as parsing it. The degradation
+// steps are: reduce all XY and Scatter series to one raster cell per pixel,
+// disable tags, and finally coarsen the raster as needed.
+void Context::apply_deadline( double min_cell )
+{
+  if ( deadline_ms == 0 ) return;
+
+  auto cost = [&]( void )
+  {
+    uint64_t c = 0;
+    for ( auto& sd : series_data ) {
+      bool all_tags = sd.tag_enable && sd.tag_filter == TagFilter::All;
+      c += sd.Size() * (all_tags ? tag_cost : 1);
+    }
+    return c;
+  };
+
+  uint64_t parsed = 0;
+  for ( auto& sd : series_data ) parsed += sd.Size();
+  double elapsed = elapsed_ms();
+  double remaining = std::max( 0.0, deadline_ms - elapsed );
+  double allowed =
+    (point_rate > 0) ? point_rate * remaining :
+    (elapsed > 0) ? parsed / elapsed * remaining : parsed;
+
+  // Only XY and Scatter series holding data points can be reduced.
+  bool reducible = false;
+  for ( auto& sd : series_data ) {
+    reducible = reducible || (is_reducible( sd ) && sd.Size() > 0);
+  }
+
+  if ( reducible && cost() > allowed ) {
+    bool reduced = false;
+    for ( auto& sd : series_data ) {
+      if ( sd.raster || !is_reducible( sd ) || sd.Size() == 0 ) continue;
+      raster_reduce( sd, min_cell );
+      reduced = true;
+    }
+    if ( reduced ) {
+      degradations.push_back( "all XY and Scatter series reduced to raster" );
+    }
+  }
+
+  if ( cost() > allowed ) {
+    bool disabled = false;
+    for ( auto& sd : series_data ) {
+      if ( !sd.tag_enable ) continue;
+      sd.tag_enable = false;
+      sd.series->SetTagEnable( false );
+      std::vector< std::string_view >().swap( sd.tag_x );
+      std::vector< std::string_view >().swap( sd.tag_y );
+      disabled = true;
+    }
+    if ( disabled ) degradations.push_back( "tags disabled" );
+  }
+
+  if ( !reducible && cost() > allowed ) {
+    degradations.push_back( "deadline cannot be met" );
+  } else if ( cost() > allowed ) {
+    uint64_t points_before;
+    uint64_t points_after;
+    bool met;
+    double cell =
+      reduce_to_limits(
+        min_cell, std::max( 1.0, allowed ), 0,
+        points_before, points_after, met
+      );
+    if ( cell > 0 ) {
+      std::ostringstream oss;
+      oss
+        << "raster cell size and prune distance raised to " << cell
+        << " (" << points_before << " -> " << points_after << " data points)";
+      degradations.push_back( oss.str() );
+    }
+    if ( !met ) {
+      degradations.push_back( "deadline cannot be met" );
+    }
+  }
+
+  for ( auto& d : degradations ) {
+    std::cerr << "*** NOTE: deadline degradation: " << d << '\n';
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Keep only the tags of the data points selected by Series.TagFilter; data
+// points with skip or invalid values are never tagged. The texts of the kept
+// tags are left untouched. This is done after all data reduction, so that the
+// selection is made among the data points that are actually shown.
+void Context::filter_tags( SeriesData& sd )
+{
+  if ( sd.tag_filter == TagFilter::All || !sd.HasTags() ) return;
+
+  const size_t n = sd.Size();
+  const size_t none = n;
+  std::vector< size_t > keep;
+  auto valid = [&]( size_t i )
+  {
+    return !sd.tag_y[ i ].empty() && !SeriesData::IsGap( sd.X( i ), sd.y[ i ] );
+  };
+
+  switch ( sd.tag_filter ) {
+    case TagFilter::Extrema : {
+      size_t lo = none;
+      size_t hi = none;
+      for ( size_t i = 0; i < n; i++ ) {
+        if ( !valid( i ) ) continue;
+        if ( lo == none || sd.y[ i ] < sd.y[ lo ] ) lo = i;
+        if ( hi == none || sd.y[ i ] > sd.y[ hi ] ) hi = i;
+      }
+      if ( lo != none ) keep.push_back( lo );
+      if ( hi != none && hi != lo ) keep.push_back( hi );
+      break;
+    }
+    case TagFilter::TopN : {
+      for ( size_t i = 0; i < n; i++ ) {
+        if ( valid( i ) ) keep.push_back( i );
+      }
+      size_t top = std::min< size_t >( keep.size(), sd.tag_filter_n );
+      // Ties are broken by index, so the first of equal values are kept.
+      std::nth_element(
+        keep.begin(), keep.begin() + top, keep.end(),
+        [&]( size_t a, size_t b )
+        {
+          return sd.y[ a ] > sd.y[ b ] || (sd.y[ a ] == sd.y[ b ] && a < b);
+        }
+      );
+      keep.resize( top );
+      break;
+    }
+    case TagFilter::Every : {
+      size_t k = sd.tag_filter_n;
+      for ( size_t i = 0; i < n; i += k ) {
+        if ( valid( i ) ) keep.push_back( i );
+      }
+      break;
+    }
+    case TagFilter::Last : {
+      for ( size_t i = n; i > 0; i-- ) {
+        if ( valid( i - 1 ) ) {
+          keep.push_back( i - 1 );
+          break;
+        }
+      }
+      break;
+    }
+    default:
+      return;
+  }
+
+  std::vector< bool > tagged( n, false );
+  for ( size_t i : keep ) tagged[ i ] = true;
+  for ( size_t i = 0; i < n; i++ ) {
+    if ( tagged[ i ] ) continue;
+    sd.tag_x[ i ] = std::string_view();
+    sd.tag_y[ i ] = std::string_view();
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Drop the tags of an XY or Scatter series that would overlap a tag of an
+// earlier data point, when Series.TagOverlap is Off. The tags are given boxes
+// from their estimated text size centered on their data point, and the kept
+// boxes are held in a uniform grid with cells at least as large as any box, so
+// only the boxes in the 3x3 neighboring cells need to be checked.
+void Context::declutter_tags( SeriesData& sd )
+{
+  if ( sd.tag_overlap || !sd.HasTags() || !is_reducible( sd ) ) return;
+
+  const ChartInfo& info = chart_info[ sd.chart ];
+  const bool x_log = info.x_log;
+  const bool y_log = info.y_log[ sd.axis_y_n ];
+  auto tagged = [&]( size_t i )
+  {
+    return
+      !sd.tag_y[ i ].empty() && !SeriesData::IsGap( sd.X( i ), sd.y[ i ] ) &&
+      (!x_log || sd.X( i ) > 0) && (!y_log || sd.y[ i ] > 0);
+  };
+  auto coord = [&]( double v, bool log )
+  {
+    return log ? std::log10( v ) : v;
+  };
+
+  // The boxes are found in points, taking the axis ranges from Axis.*.Range or
+  // else from the tagged data points.
+  double x_min = 0, x_max = 0;
+  double y_min = 0, y_max = 0;
+  bool first = true;
+  for ( size_t i = 0; i < sd.Size(); i++ ) {
+    if ( !tagged( i ) ) continue;
+    double x = coord( sd.X( i ), x_log );
+    double y = coord( sd.y[ i ], y_log );
+    if ( first || x < x_min ) x_min = x;
+    if ( first || x > x_max ) x_max = x;
+    if ( first || y < y_min ) y_min = y;
+    if ( first || y > y_max ) y_max = y;
+    first = false;
+  }
+  if ( first ) return;
+  if ( info.x_range && (!x_log || info.x_min > 0) ) {
+    x_min = coord( info.x_min, x_log );
+    x_max = coord( info.x_max, x_log );
+  }
+  const int a = sd.axis_y_n;
+  if ( info.y_range[ a ] && (!y_log || info.y_min[ a ] > 0) ) {
+    y_min = coord( info.y_min[ a ], y_log );
+    y_max = coord( info.y_max[ a ], y_log );
+  }
+  const double w = info.x_vertical ? info.area_h : info.area_w;
+  const double h = info.x_vertical ? info.area_w : info.area_h;
+  const double sx = (x_max > x_min) ? w / (x_max - x_min) : 0;
+  const double sy = (y_max > y_min) ? h / (y_max - y_min) : 0;
+
+  struct Box {
+    double x, y, w, h;
+  };
+  std::vector< Box > boxes;
+  boxes.reserve( sd.Size() );
+  const double font = TextMetrics::font_size * sd.tag_size;
+  const double pad = TextMetrics::cell_width * font;
+  double cell_w = 1;
+  double cell_h = 1;
+  for ( size_t i = 0; i < sd.Size(); i++ ) {
+    Box b{ 0, 0, 0, 0 };
+    if ( tagged( i ) ) {
+      b.x = (coord( sd.X( i ), x_log ) - x_min) * sx;
+      b.y = (coord( sd.y[ i ], y_log ) - y_min) * sy;
+      if ( info.x_vertical ) std::swap( b.x, b.y );
+      // Tags are mostly distinct, so they are not worth memoizing.
+      size_t cells = TextMetrics::Cells( sd.tag_y[ i ] ) + 1;
+      if ( !sd.tag_x[ i ].empty() ) {
+        cells += TextMetrics::Cells( sd.tag_x[ i ] ) + 2;
+      }
+      b.w = cells * pad;
+      b.h = TextMetrics::Height( font ) + pad;
+      cell_w = std::max( cell_w, b.w );
+      cell_h = std::max( cell_h, b.h );
+    }
+    boxes.push_back( b );
+  }
+
+  // Points far outside the chart area are clamped to keep the cell numbers in
+  // range; their tags are not seen anyway.
+  auto cell_of = [&]( double v, double size )
+  {
+    return static_cast< int64_t >(
+      std::floor( std::max( -1e9, std::min( 1e9, v / size ) ) )
+    );
+  };
+  auto key = [&]( int64_t cx, int64_t cy )
+  {
+    return
+      (static_cast< uint64_t >( cx ) << 32) ^ static_cast< uint32_t >( cy );
+  };
+  std::unordered_map< uint64_t, std::vector< size_t > > grid;
+  for ( size_t i = 0; i < sd.Size(); i++ ) {
+    if ( !tagged( i ) ) continue;
+    const Box& b = boxes[ i ];
+    int64_t cx = cell_of( b.x, cell_w );
+    int64_t cy = cell_of( b.y, cell_h );
+    bool overlap = false;
+    for ( int64_t dx = -1; dx <= 1 && !overlap; dx++ ) {
+      for ( int64_t dy = -1; dy <= 1 && !overlap; dy++ ) {
+        auto it = grid.find( key( cx + dx, cy + dy ) );
+        if ( it == grid.end() ) continue;
+        for ( size_t j : it->second ) {
+          const Box& o = boxes[ j ];
+          if (
+            2 * std::abs( b.x - o.x ) < b.w + o.w &&
+            2 * std::abs( b.y - o.y ) < b.h + o.h
+          ) {
+            overlap = true;
+            break;
+          }
+        }
+      }
+    }
+    if ( overlap ) {
+      sd.tag_x[ i ] = std::string_view();
+      sd.tag_y[ i ] = std::string_view();
+    } else {
+      grid[ key( cx, cy ) ].push_back( i );
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+// Hand over the categories of a chart. With Axis.X.TickSpacing: Auto a stride
+// is chosen such that the widest label fits.
+void Context::add_categories( Chart::Main* chart, ChartInfo& info )
+{
+  size_t n = info.categories.size();
+  if ( info.auto_tick_spacing && n > 1 ) {
+    double font = TextMetrics::font_size * info.x_number_size;
+    double extent = TextMetrics::Height( font ) * letter_height_adj;
+    if ( !info.x_vertical ) {
+      double max_w = 0;
+      for ( uint32_t id : info.categories ) {
+        max_w = std::max(
+          max_w, TextMetrics::Width( category_dict.Text( id ), font )
+        );
+      }
+      extent =
+        (max_w + TextMetrics::cell_width * font) * letter_width_adj;
+    }
+    double length = info.x_vertical ? info.area_h : info.area_w;
+    size_t stride = std::max( 1.0, std::ceil( n * extent / length ) );
+    chart->AxisX()->SetTickSpacing( 0, stride );
+  }
+
+  for ( uint32_t id : info.categories ) {
+    chart->AddCategory( std::string( category_dict.Text( id ) ) );
+  }
+  info.categories.clear();
+}
+
+// Hand over the data points of a series. The loop is compiled for each
+// combination of tags and X and Y precision, chosen once per series.
+template< bool tags, typename XT, typename YT >
+void add_points( SeriesData& sd, const XT* x, const YT* y )
+{
+  for ( size_t i = 0; i < sd.Size(); i++ ) {
+    const double xv = Column::Value( x[ i ] );
+    const double yv = Column::Value( y[ i ] );
+    if ( !tags || sd.tag_y[ i ].empty() ) {
+      sd.series->Add( xv, yv );
+    } else {
+      sd.series->Add( xv, yv, sd.tag_x[ i ], sd.tag_y[ i ] );
+    }
+  }
+}
+
+template< bool tags >
+void add_points( SeriesData& sd )
+{
+  sd.x_col->WithData(
+    [&]( auto x )
+    {
+      sd.y.WithData( [&]( auto y ) { add_points< tags >( sd, x, y ); } );
+    }
+  );
+}
+
+// Hand over all the collected series data to the chart library.
+void Context::flush_series_data( void )
+{
+  // Borrowed data is passed directly on to the series unless it may need to be
+  // reduced.
+  bool may_reduce = max_bytes > 0 || max_elements > 0 || deadline_ms > 0;
+  for ( auto& sd : series_data ) {
+    const ChartInfo& info = chart_info[ sd.chart ];
+    bool may_clip = info.x_range || info.y_range[ sd.axis_y_n ];
+    if ( may_reduce || may_clip || sd.raster ) sd.Materialize();
+  }
+
+  for ( auto& ci : chart_info ) {
+    add_categories( ci.first, ci.second );
+  }
+
+  double px = pixel_size();
+  for ( auto& sd : series_data ) {
+    if ( target_width > 0 ) {
+      sd.prune_dist *= px;
+      sd.series->SetPruneDist( sd.prune_dist );
+    }
+    clip_to_range( sd );
+    if ( sd.raster ) raster_reduce( sd, px );
+  }
+  apply_output_budget( px );
+  apply_deadline( px );
+  for ( auto& sd : series_data ) {
+    filter_tags( sd );
+    declutter_tags( sd );
+    if ( sd.Size() > 0 ) {
+      if ( sd.HasTags() ) {
+        add_points< true >( sd );
+      } else {
+        add_points< false >( sd );
+      }
+    }
+    for ( const auto& b : sd.borrowed ) {
+      for ( size_t i = 0; i < b.n; i++ ) sd.series->Add( b.x[ i ], b.y[ i ] );
+    }
+  }
+  series_data.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::process_line(
+  const std::string& line, size_t line_number, uint32_t file_name_idx
+)
+{
+  bool macro_def = false;
+  bool macro_end = false;
+  if ( line.size() >= 9 && line.compare( 0, 5, "Macro" ) == 0 ) {
+    macro_def = line.compare( 5, 4, "Def:" ) == 0;
+    macro_end = line.compare( 5, 4, "End:" ) == 0;
+  }
+  bool macro = macro_def || !in_macro_name.empty();;
+  lines.push_back(
+    { line_text.Store( line ), line_number, file_name_idx, macro, macro_end }
+  );
+  if ( macro_def || macro_end ) {
+    cur_line = lines.end() - 1;
+    cur_col = 9;
+    skip_ws();
+    std::string macro_name = get_identifier();
+    expect_eol();
+    if ( macro_name.empty() ) {
+      parse_err( "macro name expected", true );
+    }
+    if ( macro_def ) {
+      if ( !in_macro_name.empty() ) {
+        cur_col = 0;
+        parse_err( "nested macro definitions not allowed" );
+      }
+      if ( macros.count( macro_name ) ) {
+        parse_err( "macro '" + macro_name + "' already defined", true );
+      }
+      macros[ macro_name ] = lines.size() - 1;
+      in_macro_name = macro_name;
+    } else {
+      if ( in_macro_name.empty() ) {
+        cur_col = 0;
+        parse_err( "not defining macro" );
+      }
+      if ( macro_name != in_macro_name ) {
+        parse_err( "macro name mismatch", true );
+      }
+      in_macro_name.clear();
+    }
+  }
+}
+
+// Insert an XML comment at the start of the generated output, but after any XML
+// declaration.
+void annotate_output( std::string& out, const std::string& comment )
+{
+  size_t pos = 0;
+  if ( out.compare( 0, 5, "<?xml" ) == 0 ) {
+    pos = out.find( '\n' );
+    pos = (pos == std::string::npos) ? out.size() : pos + 1;
+  }
+  out.insert( pos, "<!-- " + comment + " -->\n" );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Context::process_stream( std::istream& in, const std::string& name )
+{
+  if ( parsed ) {
+    throw Error( "*** ERROR: input '" + name + "' added after parsing" );
+  }
+  if ( file_names.empty() ) start_time = std::chrono::steady_clock::now();
+  uint32_t file_name_idx = file_names.size();
+  file_names.push_back( name );
+  size_t line_number = 0;
+  std::string line;
+  while ( std::getline( in, line ) ) {
+    trunc_nl( line );
+    process_line( line, ++line_number, file_name_idx );
+  }
+}
+
+void Context::AddFile( const std::string& file_name )
+{
+  if ( file_name == "-" ) {
+    process_stream( std::cin, file_name );
+  } else {
+    std::ifstream file( file_name );
+    if ( !file ) {
+      throw Error( "*** ERROR: Unable to open file '" + file_name + "'" );
+    }
+    process_stream( file, file_name );
+  }
+}
+
+void Context::AddText( const std::string& name, const std::string& text )
+{
+  std::istringstream iss( text );
+  process_stream( iss, name );
+}
+
+void Context::Parse( void )
+{
+  if ( parsed ) return;
+  if ( !in_macro_name.empty() ) {
+    cur_line = lines.end();
+    cur_col = 0;
+    parse_err( "macro '" + in_macro_name + "' not ended" );
+  }
+  parse_lines();
+  release_input();
+  parsed = true;
+}
+
+std::string Context::Build( void )
+{
+  Parse();
+  flush_series_data();
+
+  std::string out = ensemble.Build();
+  if ( target_width > 0 ) {
+    annotate_output( out, "target-width: " + std::to_string( target_width ) );
+  }
+  for ( auto it = degradations.rbegin(); it != degradations.rend(); ++it ) {
+    annotate_output( out, "deadline degradation: " + *it );
+  }
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
@@ -0,0 +1,989 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <chart_ensemble.h>
+#include <chartgen_kernels.h>
+#include <chartgen_text.h>
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Thrown on any error; the message is ready to be shown to the user.
+class Error : public std::runtime_error
+{
+public:
+  explicit Error( const std::string& msg ) : std::runtime_error( msg ) {}
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Storage for the text of the input lines. The texts are copied into large
+// chunks that are freed in bulk, rather than each line having its own heap
+// allocation, and they never move, so views into them stay valid.
+class TextArena
+{
+public:
+
+  std::string_view Store( std::string_view text )
+  {
+    if ( text.empty() ) return std::string_view();
+    char* p;
+    if ( text.size() > chunk_size / 4 ) {
+      chunks.emplace_back( new char[ text.size() ] );
+      p = chunks.back().get();
+    } else {
+      if ( text.size() > avail ) {
+        chunks.emplace_back( new char[ chunk_size ] );
+        next = chunks.back().get();
+        avail = chunk_size;
+      }
+      p = next;
+      next += text.size();
+      avail -= text.size();
+    }
+    std::memcpy( p, text.data(), text.size() );
+    return std::string_view( p, text.size() );
+  }
+
+private:
+
+  static const size_t chunk_size = 1 << 20;
+
+  std::vector< std::unique_ptr< char[] > > chunks;
+  char*  next = nullptr;
+  size_t avail = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Dictionary of category texts, where each distinct text is given a 32-bit id.
+// The texts are views into the input lines, which outlive the dictionary, and
+// the hash of each text is stored to avoid string compares on collisions.
+class CategoryDict
+{
+public:
+
+  uint32_t Intern( std::string_view text )
+  {
+    if ( 2 * (texts.size() + 1) > slots.size() ) grow();
+    uint64_t hash = std::hash< std::string_view >()( text );
+    size_t mask = slots.size() - 1;
+    for ( size_t i = hash & mask; ; i = (i + 1) & mask ) {
+      Slot& slot = slots[ i ];
+      if ( slot.id == none ) {
+        slot.hash = hash;
+        slot.id = texts.size();
+        texts.push_back( text );
+        return slot.id;
+      }
+      if ( slot.hash == hash && texts[ slot.id ] == text ) return slot.id;
+    }
+  }
+
+  std::string_view Text( uint32_t id ) const { return texts[ id ]; }
+
+  // Copy the texts to the arena, so the input lines can be released.
+  void MoveTexts( TextArena& arena )
+  {
+    for ( auto& text : texts ) text = arena.Store( text );
+  }
+
+  size_t Size( void ) const { return texts.size(); }
+
+private:
+
+  static const uint32_t none = UINT32_MAX;
+
+  struct Slot {
+    uint64_t hash = 0;
+    uint32_t id = none;
+  };
+
+  void grow( void )
+  {
+    std::vector< Slot > old( std::max< size_t >( 64, 2 * slots.size() ) );
+    old.swap( slots );
+    size_t mask = slots.size() - 1;
+    for ( const Slot& slot : old ) {
+      if ( slot.id == none ) continue;
+      size_t i = slot.hash & mask;
+      while ( slots[ i ].id != none ) i = (i + 1) & mask;
+      slots[ i ] = slot;
+    }
+  }
+
+  std::vector< Slot >             slots;
+  std::vector< std::string_view > texts;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Per chart information needed when reducing the series data prior to handing
+// it over to the chart library.
+struct ChartInfo {
+  int64_t area_w = 1000;
+  int64_t area_h = 600;
+  bool x_vertical = false;
+  bool x_log = false;
+  bool y_log[ 2 ] = { false, false };
+  bool x_range = false;
+  double x_min = 0;
+  double x_max = 0;
+  bool y_range[ 2 ] = { false, false };
+  double y_min[ 2 ] = { 0, 0 };
+  double y_max[ 2 ] = { 0, 0 };
+
+  // The categories of the chart in order, as ids in the CategoryDict.
+  std::vector< uint32_t > categories;
+  bool auto_tick_spacing = false;
+  double x_number_size = 1.0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Move the elements given by the ascending list of indices to the front of the
+// vector and drop the rest.
+template< typename T >
+void keep_elements( std::vector< T >& v, const std::vector< size_t >& keep )
+{
+  size_t n = 0;
+  for ( size_t i : keep ) v[ n++ ] = v[ i ];
+  v.resize( n );
+}
+
+// A column of data point coordinates held in either double or single
+// precision. In single precision the skip and invalid values are held as plus
+// and minus infinity, and any other value is clamped to the float range.
+class Column
+{
+public:
+
+  Column( void ) : single( false ) {}
+  explicit Column( bool single ) : single( single ) {}
+
+  bool Single( void ) const { return single; }
+
+  size_t size( void ) const { return single ? f.size() : d.size(); }
+  size_t capacity( void ) const
+  {
+    return single ? f.capacity() : d.capacity();
+  }
+  void reserve( size_t n )
+  {
+    if ( single ) f.reserve( n ); else d.reserve( n );
+  }
+  void resize( size_t n )
+  {
+    if ( single ) f.resize( n ); else d.resize( n );
+  }
+
+  double operator[]( size_t i ) const
+  {
+    return single ? from_float( f[ i ] ) : d[ i ];
+  }
+
+  void Set( size_t i, double v )
+  {
+    if ( single ) f[ i ] = to_float( v ); else d[ i ] = v;
+  }
+
+  void push_back( double v )
+  {
+    if ( single ) f.push_back( to_float( v ) ); else d.push_back( v );
+  }
+
+  void append( const double* v, size_t n )
+  {
+    if ( single ) {
+      for ( size_t i = 0; i < n; i++ ) f.push_back( to_float( v[ i ] ) );
+    } else {
+      d.insert( d.end(), v, v + n );
+    }
+  }
+
+  // Minimum and maximum of the values from index b to e (excluding), which must
+  // not be skip or invalid values.
+  void MinMax( size_t b, size_t e, double& min, double& max ) const
+  {
+    if ( single ) {
+      min_max( f.data() + b, e - b, min, max );
+    } else {
+      min_max( d.data() + b, e - b, min, max );
+    }
+  }
+
+  // Map the values from index b to e (excluding) to raster cells; see
+  // map_to_cells.
+  void MapToCells(
+    size_t b, size_t e,
+    bool log, double min, double max, int64_t cells, int64_t* out
+  ) const
+  {
+    if ( single ) {
+      map_to_cells( f.data() + b, e - b, log, min, max, cells, out );
+    } else {
+      map_to_cells( d.data() + b, e - b, log, min, max, cells, out );
+    }
+  }
+
+  // Set bit below/above in the clip codes of the values from index b to e
+  // (excluding) that are below lo/above hi; see clip_codes.
+  void ClipCodes(
+    size_t b, size_t e,
+    double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+  ) const
+  {
+    if ( single ) {
+      clip_codes( f.data() + b, e - b, lo, hi, below, above, codes );
+    } else {
+      clip_codes( d.data() + b, e - b, lo, hi, below, above, codes );
+    }
+  }
+
+  // Call fn with a pointer to the values as they are stored, double or float,
+  // so a loop over the values can be compiled for each precision instead of
+  // checking the precision for each value; read the values through Value.
+  template< typename F >
+  void WithData( F fn ) const
+  {
+    if ( single ) fn( f.data() ); else fn( d.data() );
+  }
+  static double Value( double v ) { return v; }
+  static double Value( float  v ) { return from_float( v ); }
+
+  // Retain only the values given by the ascending list of indices, or get a
+  // copy of just those values.
+  void Keep( const std::vector< size_t >& keep )
+  {
+    if ( single ) keep_elements( f, keep ); else keep_elements( d, keep );
+  }
+  Column Select( const std::vector< size_t >& keep ) const
+  {
+    Column c( single );
+    c.reserve( keep.size() );
+    if ( single ) {
+      for ( size_t i : keep ) c.f.push_back( f[ i ] );
+    } else {
+      for ( size_t i : keep ) c.d.push_back( d[ i ] );
+    }
+    return c;
+  }
+
+  // Copy of the first n values.
+  Column Head( size_t n ) const
+  {
+    Column c( single );
+    if ( single ) {
+      c.f.assign( f.begin(), f.begin() + n );
+    } else {
+      c.d.assign( d.begin(), d.begin() + n );
+    }
+    return c;
+  }
+
+  // Check if a value can be held in single precision.
+  static bool FitsFloat( double v )
+  {
+    return
+      v == Chart::num_skip || v == Chart::num_invalid ||
+      std::abs( v ) <= std::numeric_limits< float >::max();
+  }
+
+private:
+
+  static float to_float( double v )
+  {
+    const double inf = std::numeric_limits< float >::infinity();
+    const double max = std::numeric_limits< float >::max();
+    if ( v == Chart::num_skip    ) return +inf;
+    if ( v == Chart::num_invalid ) return -inf;
+    return std::max( -max, std::min( +max, v ) );
+  }
+
+  static double from_float( float v )
+  {
+    if ( std::isinf( v ) ) {
+      return (v > 0) ? Chart::num_skip : Chart::num_invalid;
+    }
+    return v;
+  }
+
+  bool single;
+  std::vector< double > d;
+  std::vector< float  > f;
+};
+
+
+// Selection of the data points to be tagged (see Series.TagFilter).
+enum class TagFilter { All, Extrema, TopN, Every, Last };
+
+// The series data is collected here while parsing and only handed over to the
+// Chart::Series objects once all input has been parsed (see flush_series_data).
+struct SeriesData {
+  Chart::Main*      chart;
+  Chart::Series*    series;
+  Chart::SeriesType type;
+  int               axis_y_n = 0;
+  double            prune_dist = 0;
+  bool              raster = false;
+  bool              tag_enable = false;
+  double            tag_size = 1.0;
+  bool              tag_overlap = true;
+  TagFilter         tag_filter = TagFilter::All;
+  int64_t           tag_filter_n = 0;
+  bool              clip_ingest = false;
+  bool              contour = false;
+
+  // The X-values are shared by all the series created from the same data block,
+  // so the X column is copied only if a series is modified on its own. The X
+  // column is only created once the first data point is added, as most series
+  // will share one anyway. The tags are only stored when tags are enabled.
+  std::shared_ptr< Column >       x_col;
+  Column                          y;
+  std::vector< std::string_view > tag_x;
+  std::vector< std::string_view > tag_y;
+
+  // Ascending indices of the data points having a skip or invalid X- or
+  // Y-value. The values are also held in the columns, but the runs of data
+  // points in between can thereby be processed without checking each value.
+  std::vector< size_t > gaps;
+
+  // Indicates if the X-values are ascending, in which case there are no skip or
+  // invalid X-values.
+  bool   x_sorted = true;
+  double x_last = -std::numeric_limits< double >::infinity();
+
+  // Data added through the C API (see chartgen_capi.h); the caller owns the
+  // memory, which must stay valid until the chart has been built.
+  struct Borrowed {
+    const double* x;
+    const double* y;
+    size_t        n;
+  };
+  std::vector< Borrowed > borrowed;
+
+  size_t Size( void ) const { return y.size(); }
+
+  double X( size_t i ) const { return (*x_col)[ i ]; }
+
+  bool HasTags( void ) const { return !tag_y.empty(); }
+
+  static bool IsGap( double x, double y )
+  {
+    return
+      x == Chart::num_skip || x == Chart::num_invalid ||
+      y == Chart::num_skip || y == Chart::num_invalid;
+  }
+
+  void TrackX( double x )
+  {
+    if ( x == Chart::num_skip || x == Chart::num_invalid || x < x_last ) {
+      x_sorted = false;
+    }
+    x_last = x;
+  }
+
+  // Recreate the gap list after the values have been changed directly.
+  void ScanGaps( void )
+  {
+    gaps.clear();
+    for ( size_t i = 0; i < Size(); i++ ) {
+      if ( IsGap( X( i ), y[ i ] ) ) gaps.push_back( i );
+    }
+  }
+
+  // Call run( begin, end ) for each run of data points without skip or invalid
+  // values, and gap( i ) for each data point in between, in order.
+  template< typename R, typename G >
+  void ForEachRun( R run, G gap ) const
+  {
+    size_t i = 0;
+    for ( size_t g : gaps ) {
+      if ( g > i ) run( i, g );
+      gap( g );
+      i = g + 1;
+    }
+    if ( Size() > i ) run( i, Size() );
+  }
+
+  // Select single (float) or double precision; the series must be empty.
+  void SetSinglePrecision( bool single )
+  {
+    x_col.reset();
+    y = Column( single );
+  }
+  bool SinglePrecision( void ) const { return y.Single(); }
+
+  // Start sharing the given X column; the series must be empty.
+  void ShareX( const std::shared_ptr< Column >& col )
+  {
+    x_col = col;
+  }
+  bool SharesX( const std::shared_ptr< Column >& col ) const
+  {
+    return x_col && x_col == col;
+  }
+
+  // Get the X column for modification, copying it first if shared.
+  Column& OwnX( void )
+  {
+    if ( !x_col ) {
+      x_col = std::make_shared< Column >( y.Single() );
+    } else if ( x_col.use_count() > 1 ) {
+      x_col = std::make_shared< Column >( x_col->Head( Size() ) );
+    }
+    return *x_col;
+  }
+
+  // Make room for a total of n data points; grows geometrically as needed so
+  // that repeated calls for small data blocks stay cheap.
+  void Reserve( size_t n )
+  {
+    if ( n <= y.capacity() ) return;
+    n = std::max( n, 2 * y.capacity() );
+    if ( x_col.use_count() <= 1 ) OwnX().reserve( n );
+    y.reserve( n );
+    if ( tag_enable ) {
+      tag_x.reserve( n );
+      tag_y.reserve( n );
+    }
+  }
+
+  // Add n data points without tags.
+  void AddBatch( const double* x, const double* y, size_t n )
+  {
+    Reserve( Size() + n );
+    auto& xs = OwnX();
+    xs.append( x, n );
+    this->y.append( y, n );
+    for ( size_t i = 0; i < n; i++ ) {
+      if ( IsGap( x[ i ], y[ i ] ) ) gaps.push_back( Size() - n + i );
+      TrackX( x[ i ] );
+    }
+    if ( tag_enable ) {
+      tag_x.resize( Size() );
+      tag_y.resize( Size() );
+    }
+  }
+
+  // Add the Y-value of a data point whose X-value has already been added to
+  // the shared X column.
+  void AddY(
+    double y,
+    std::string_view tag_x = std::string_view(),
+    std::string_view tag_y = std::string_view()
+  )
+  {
+    double x = X( Size() );
+    if ( IsGap( x, y ) ) gaps.push_back( Size() );
+    TrackX( x );
+    this->y.push_back( y );
+    if ( tag_enable ) {
+      this->tag_x.push_back( tag_x );
+      this->tag_y.push_back( tag_y );
+    }
+  }
+
+  void Add(
+    double x, double y,
+    std::string_view tag_x = std::string_view(),
+    std::string_view tag_y = std::string_view()
+  )
+  {
+    OwnX().push_back( x );
+    AddY( y, tag_x, tag_y );
+  }
+
+  // Copy any borrowed data points into the owned vectors, as needed before the
+  // data points can be reduced.
+  void Materialize( void )
+  {
+    for ( const auto& b : borrowed ) AddBatch( b.x, b.y, b.n );
+    borrowed.clear();
+  }
+
+  // Retain only the data points given by the ascending list of indices.
+  void Keep( const std::vector< size_t >& keep )
+  {
+    if ( !x_col ) return;
+    if ( x_col.use_count() > 1 ) {
+      x_col = std::make_shared< Column >( x_col->Select( keep ) );
+    } else {
+      x_col->Keep( keep );
+    }
+    y.Keep( keep );
+    if ( HasTags() ) {
+      keep_elements( tag_x, keep );
+      keep_elements( tag_y, keep );
+    }
+    size_t g = 0;
+    std::vector< size_t > kept_gaps;
+    for ( size_t n = 0; n < keep.size() && g < gaps.size(); n++ ) {
+      while ( g < gaps.size() && gaps[ g ] < keep[ n ] ) g++;
+      if ( g < gaps.size() && gaps[ g ] == keep[ n ] ) kept_gaps.push_back( n );
+    }
+    gaps.swap( kept_gaps );
+  }
+};
+
+
+// The window in which the data points of a series may be seen, as given by
+// Axis.*.Range but extended by a margin (see Context::clip_window).
+struct ClipWindow {
+  static const uint8_t left = 1, right = 2, below = 4, above = 8;
+
+  bool x_range = false;
+  bool y_range = false;
+  double x_lo = 0;
+  double x_hi = 0;
+  double y_lo = 0;
+  double y_hi = 0;
+
+  // The line between two data points cannot be seen if the bitwise and of
+  // their codes is non-zero.
+  uint8_t Code( double x, double y ) const
+  {
+    uint8_t c = 0;
+    if ( x_range ) c |= ((x < x_lo) ? left  : 0) | ((x > x_hi) ? right : 0);
+    if ( y_range ) c |= ((y < y_lo) ? below : 0) | ((y > y_hi) ? above : 0);
+    return c;
+  }
+};
+
+// Adds data points to a series while dropping those which cannot be seen (see
+// Series.Clip). This follows Context::clip_to_range, except that a data point
+// is held back until the next one is known.
+struct ClipIngest {
+  ClipWindow window;
+  bool scatter = false;
+
+  bool             pending = false;
+  double           p_x;
+  double           p_y;
+  std::string_view p_tag_x;
+  std::string_view p_tag_y;
+  uint8_t          p_code;
+  bool             p_keep;
+  bool             in_break = false;
+
+  void Add(
+    SeriesData& sd, double x, double y,
+    std::string_view tag_x = std::string_view(),
+    std::string_view tag_y = std::string_view()
+  )
+  {
+    if ( SeriesData::IsGap( x, y ) ) {
+      Flush( sd );
+      sd.Add( x, y, tag_x, tag_y );
+      return;
+    }
+    uint8_t code = window.Code( x, y );
+    if ( scatter ) {
+      if ( code == 0 ) sd.Add( x, y, tag_x, tag_y );
+      return;
+    }
+    bool visible = false;
+    if ( pending ) {
+      visible = (p_code & code) == 0;
+      if ( p_keep || visible ) {
+        sd.Add( p_x, p_y, p_tag_x, p_tag_y );
+        in_break = false;
+      } else if ( !in_break ) {
+        sd.Add( p_x, Chart::num_invalid );
+        in_break = true;
+      }
+    }
+    // The first data point of a run is always kept.
+    p_keep = !pending || visible;
+    pending = true;
+    p_x = x;
+    p_y = y;
+    p_tag_x = tag_x;
+    p_tag_y = tag_y;
+    p_code = code;
+  }
+
+  // The last data point of a run is always kept.
+  void Flush( SeriesData& sd )
+  {
+    if ( pending ) sd.Add( p_x, p_y, p_tag_x, p_tag_y );
+    pending = false;
+    in_break = false;
+  }
+};
+
+struct state_t {
+  std::vector< Chart::Series* > series_list;
+  std::vector< SeriesData* > data_list;
+  std::vector< Chart::SeriesType > type_list;
+
+  bool defining_series = false;
+  bool series_type_defined = false;
+  Chart::SeriesType series_type = Chart::SeriesType::XY;
+  bool contour = false;
+  std::vector< double > contour_levels;
+  double contour_x0 = 0;
+  double contour_y0 = 0;
+  double contour_dx = 1;
+  double contour_dy = 1;
+  double prune_dist = 0.3;
+  bool raster = false;
+  bool single_precision = false;
+  bool clip_ingest = false;
+  std::vector< uint32_t > columns;
+  int32_t category_idx = 0;
+  bool global_legend = false;
+  bool legend_outline = true;
+  int axis_y_n = 0;
+  double series_base = 0;
+  int64_t style = 0;
+  Chart::MarkerShape marker_shape = Chart::MarkerShape::Circle;
+  double marker_size = -1;
+  double line_width = -1;
+  double line_dash = -1;
+  double line_hole = -1;
+  double lighten = 0.0;
+  double fill_transparency = -1;
+  bool tag_enable = false;
+  Chart::Pos tag_pos = Chart::Pos::Auto;
+  double tag_size = 1.0;
+  bool tag_box = false;
+  bool tag_overlap = true;
+  TagFilter tag_filter = TagFilter::All;
+  int64_t tag_filter_n = 0;
+  SVG::Color tag_text_color;
+  SVG::Color tag_fill_color;
+  SVG::Color tag_line_color;
+  // Set once any of the tag colors above is given, until reset by a new style.
+  bool tag_colors = false;
+};
+
+// The text of the line is held in the TextArena of the Context.
+struct LineRec {
+  std::string_view line;
+  size_t      line_number;
+  uint32_t    file_name_idx;
+  bool        macro = false;
+  bool        macro_end = false;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Holds all state needed to generate one chart ensemble from chartgen input.
+// Independent Context objects may be used concurrently from different threads.
+class Context
+{
+public:
+
+  Context( void );
+
+  void EnableHTML( bool enable ) { ensemble.EnableHTML( enable ); }
+
+  // Output budget; zero means no limit.
+  void SetMaxBytes( uint64_t n ) { max_bytes = n; }
+  void SetMaxElements( uint64_t n ) { max_elements = n; }
+
+  // Width in pixels of the final bitmap; zero means unknown.
+  void SetTargetWidth( uint64_t n ) { target_width = n; }
+
+  // Latency deadline in milliseconds, counted from when the first input is
+  // added; zero means none.
+  void SetDeadline( uint64_t ms ) { deadline_ms = ms; }
+
+  // Add input from the given file; "-" means standard input. Input cannot be
+  // added once parsed.
+  void AddFile( const std::string& file_name );
+
+  // Add input from a string; the name is used in error messages.
+  void AddText( const std::string& name, const std::string& text );
+
+  // Parse all the added input; done by Build if not called before. After this
+  // the series defined by the input may be accessed through GetSeries.
+  void Parse( void );
+
+  // The series in the order they were defined by the input.
+  size_t SeriesCount( void ) const { return series_data.size(); }
+  SeriesData* GetSeries( size_t idx ) { return &series_data.at( idx ); }
+
+  // Parse all the added input and generate the SVG or HTML output. Can only be
+  // called once.
+  std::string Build( void );
+
+private:
+
+  using LineRecIter = std::vector< LineRec >::iterator;
+
+  using ChartAction = void (Context::*)( void );
+  using AxisAction  = void (Context::*)( Chart::Axis* );
+
+  static const std::unordered_map< std::string, ChartAction > chart_actions;
+  static const std::unordered_map< std::string, AxisAction  > axis_actions;
+
+  Chart::Ensemble ensemble;
+
+  bool grid_max_defined = false;
+  uint32_t grid_max_row = 0;
+  uint32_t grid_max_col = 0;
+  Chart::Pos footnote_pos = Chart::Pos::Auto;
+
+  std::map< Chart::Main*, ChartInfo > chart_info;
+  CategoryDict category_dict;
+
+  double letter_width_adj = 1.0;
+  double letter_height_adj = 1.0;
+  std::deque< SeriesData > series_data;
+
+  state_t state;
+
+  std::vector< std::string > file_names;
+
+  // The category and tag texts are moved here from line_text when the input
+  // lines are released after parsing (see release_input).
+  TextArena kept_text;
+
+  TextArena line_text;
+  std::vector< LineRec > lines;
+  LineRecIter            cur_line;
+  size_t                 cur_col = 0;
+
+  std::map< std::string, size_t > macros;
+
+  std::vector< LineRecIter > macro_stack;
+
+  std::vector< LineRecIter > saved_macro_stack[ 2 ];
+  LineRecIter                saved_line[ 2 ];
+
+  std::string in_macro_name;
+
+  // Start column of last parsed identifier.
+  size_t id_col = 0;
+
+  // Indicates if a chart has been started without a preceding New.
+  bool non_newed_chart = false;
+
+  bool parsed = false;
+
+  uint64_t max_bytes = 0;
+  uint64_t max_elements = 0;
+  uint64_t target_width = 0;
+  uint64_t deadline_ms = 0;
+
+  std::chrono::steady_clock::time_point start_time;
+
+  // Parse throughput in data points per millisecond, sampled over the first
+  // deadline_sample data rows parsed under a deadline; zero until sampled.
+  static constexpr uint64_t deadline_sample = 65536;
+  double point_rate = 0;
+  uint64_t sample_rows = 0;
+  double sample_ms = 0;
+
+  // Only every row_stride'th data row of XY and Scatter series is parsed, as
+  // chosen from the sampled throughput to meet the deadline.
+  uint64_t row_stride = 1;
+  bool rows_skipped = false;
+
+  // The degradations applied in order to meet the deadline.
+  std::vector< std::string > degradations;
+
+  void save_line_pos( uint32_t context = 0 );
+  void restore_line_pos( uint32_t context = 0 );
+  bool at_eof( void );
+  bool at_eol( void );
+  bool at_ws( void );
+  void skip_ws( bool multi_line = false );
+  [[noreturn]]
+  void parse_err( const std::string& msg, bool revert_col = false );
+  char get_char( bool adv = true );
+  std::string get_identifier( bool all_non_ws = false );
+  bool get_int64( int64_t& i );
+  bool get_double( double& d, bool none_allowed = false );
+  bool get_category( std::string_view& t, bool& quoted );
+  bool get_key( std::string& key );
+  void get_text( std::string& txt, bool multi_line );
+  void expect_eol( void );
+  void expect_ws( const std::string err_msg_if_eol = "" );
+  void next_line( void );
+  void do_Pos(
+    Chart::Pos& pos, int& axis_y_n
+  );
+  void do_Pos(
+    Chart::Pos& pos
+  );
+  void do_Switch(
+    bool& flag
+  );
+  void do_Color(
+    SVG::Color* color
+  );
+  bool do_GridPos(
+    int64_t& row1, int64_t& col1,
+    int64_t& row2, int64_t& col2
+  );
+  Chart::Main* CurChart( void );
+  void do_New( void );
+  void do_Margin( void );
+  void do_BorderColor( void );
+  void do_BorderWidth( void );
+  void do_Padding( void );
+  void do_GridPadding( void );
+  void do_GlobalLegendHeading( void );
+  void do_GlobalLegendFrame( void );
+  void do_GlobalLegendPos( void );
+  void do_GlobalLegendSize( void );
+  void do_GlobalLegendColor( void );
+  void do_LetterSpacing( void );
+  void do_ChartArea( void );
+  void do_ChartBox( void );
+  void do_ForegroundColor( void );
+  void do_BackgroundColor( void );
+  void do_ChartAreaColor( void );
+  void do_AxisColor( void );
+  void do_GridColor( void );
+  void do_TextColor( void );
+  void do_FrameColor( void );
+  void do_GlobalTitle( void );
+  void do_GlobalSubTitle( void );
+  void do_GlobalSubSubTitle( void );
+  void do_GlobalTitlePos( void );
+  void do_GlobalTitleSize( void );
+  void do_GlobalTitleLine( void );
+  void do_Title( void );
+  void do_SubTitle( void );
+  void do_SubSubTitle( void );
+  void do_TitleFrame( void );
+  void do_TitlePos( void );
+  void do_TitleInside( void );
+  void do_TitleSize( void );
+  void do_Footnote( void );
+  void do_FootnotePos( void );
+  void do_FootnoteLine( void );
+  void do_FootnoteSize( void );
+  void do_Axis_Orientation( Chart::Axis* axis );
+  void do_Axis_Reverse( Chart::Axis* axis );
+  void do_Axis_Style( Chart::Axis* axis );
+  void do_Axis_Label( Chart::Axis* axis );
+  void do_Axis_SubLabel( Chart::Axis* axis );
+  void do_Axis_LabelSize( Chart::Axis* axis );
+  void do_Axis_Unit( Chart::Axis* axis );
+  void do_Axis_UnitPos( Chart::Axis* axis );
+  void do_Axis_LogScale( Chart::Axis* axis );
+  void do_Axis_Range( Chart::Axis* axis );
+  void do_Axis_Pos( Chart::Axis* axis );
+  void do_Axis_Tick( Chart::Axis* axis );
+  void do_Axis_TickSpacing( Chart::Axis* axis );
+  void do_Axis_Grid( Chart::Axis* axis );
+  void do_Axis_GridStyle( Chart::Axis* axis );
+  void do_Axis_GridColor( Chart::Axis* axis );
+  void do_Axis_NumberFormat( Chart::Axis* axis );
+  void do_Axis_NumberSign( Chart::Axis* axis );
+  void do_Axis_NumberUnit( Chart::Axis* axis );
+  void do_Axis_MinorNumber( Chart::Axis* axis );
+  void do_Axis_NumberPos( Chart::Axis* axis );
+  void do_Axis_NumberSize( Chart::Axis* axis );
+  void do_LegendHeading( void );
+  void do_LegendFrame( void );
+  void do_LegendPos( void );
+  void do_LegendSize( void );
+  void do_BarWidth( void );
+  void do_LayeredBarWidth( void );
+  void do_BarMargin( void );
+  void NextSeriesStyle( void );
+  void ApplyMarkerSize( Chart::Series* series );
+  void AddSeries( std::string name = "", bool anonymous_snap = false );
+  void do_Series_Type( void );
+  void do_Series_New( void );
+  void do_Series_Prune( void );
+  void do_Series_Raster( void );
+  void do_Series_Precision( void );
+  void do_Series_Clip( void );
+  void do_Series_Columns( void );
+  void do_Series_GlobalLegend( void );
+  void do_Series_LegendOutline( void );
+  void do_Series_Axis( void );
+  void do_Series_Base( void );
+  void do_Series_Style( void );
+  void do_Series_MarkerShape( void );
+  void do_Series_MarkerSize( void );
+  void do_Series_LineWidth( void );
+  void do_Series_LineDash( void );
+  void do_Series_Lighten( void );
+  void do_Series_FillTransparency( void );
+  void do_Series_LineColor( void );
+  void do_Series_FillColor( void );
+  void do_Series_Tag( void );
+  void do_Series_TagPos( void );
+  void do_Series_TagSize( void );
+  void do_Series_TagBox( void );
+  void do_Series_TagOverlap( void );
+  void do_Series_TagFilter( void );
+  void do_Series_TagTextColor( void );
+  void do_Series_TagFillColor( void );
+  void do_Series_TagLineColor( void );
+  void parse_series_data( bool anonymous_snap = false );
+  void do_Series_Contour( void );
+  void do_Series_ContourGrid( void );
+  void trace_contours(
+    const std::vector< SeriesData* >& sds, const std::vector< double >& levels,
+    const std::vector< double >& field, size_t rows, size_t cols
+  );
+  void parse_contour_data( void );
+  void do_Series_Data( void );
+  bool parse_spec( void );
+  void parse_lines( void );
+  void release_input( void );
+  double pixel_size( void );
+  bool clip_window( const SeriesData& sd, ClipWindow& window );
+  void clip_to_range( SeriesData& sd );
+  void raster_keep( SeriesData& sd, double cell, std::vector< size_t >& keep );
+  void raster_reduce( SeriesData& sd, double cell = 1.0 );
+  double reduce_to_limits(
+    double min_cell, uint64_t elements_limit, uint64_t bytes_limit,
+    uint64_t& points_before, uint64_t& points_after, bool& met
+  );
+  void apply_output_budget( double min_cell );
+  double elapsed_ms( void ) const;
+  void sample_throughput( uint32_t y_values );
+  void apply_deadline( double min_cell );
+  void filter_tags( SeriesData& sd );
+  void declutter_tags( SeriesData& sd );
+  void add_categories( Chart::Main* chart, ChartInfo& info );
+  void flush_series_data( void );
+  void process_line(
+    const std::string& line, size_t line_number, uint32_t file_name_idx
+  );
+  void process_stream( std::istream& in, const std::string& name );
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
@@ -0,0 +1,183 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <algorithm>
+#include <cmath>
+#include <chartgen_kernels.h>
+
+// The implementations are inlined into each of the instruction set specific
+// clones of the kernel functions.
+#if defined( __GNUC__ ) && defined( __x86_64__ ) && defined( __linux__ )
+#define KERNEL __attribute__(( target_clones( "avx512f", "avx2", "default" ) ))
+#else
+#define KERNEL
+#endif
+#define INLINE inline __attribute__(( always_inline ))
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Several independent accumulators let the compiler use vector instructions.
+template< typename T >
+INLINE void min_max_impl( const T* v, size_t n, double& min, double& max )
+{
+  const size_t L = 8;
+  T lo[ L ];
+  T hi[ L ];
+  for ( size_t k = 0; k < L; k++ ) lo[ k ] = hi[ k ] = v[ 0 ];
+  size_t i = 0;
+  for ( ; i + L <= n; i += L ) {
+    for ( size_t k = 0; k < L; k++ ) {
+      lo[ k ] = (v[ i + k ] < lo[ k ]) ? v[ i + k ] : lo[ k ];
+      hi[ k ] = (v[ i + k ] > hi[ k ]) ? v[ i + k ] : hi[ k ];
+    }
+  }
+  for ( ; i < n; i++ ) {
+    lo[ 0 ] = (v[ i ] < lo[ 0 ]) ? v[ i ] : lo[ 0 ];
+    hi[ 0 ] = (v[ i ] > hi[ 0 ]) ? v[ i ] : hi[ 0 ];
+  }
+  min = *std::min_element( lo, lo + L );
+  max = *std::max_element( hi, hi + L );
+}
+
+KERNEL void min_max( const double* v, size_t n, double& min, double& max )
+{
+  min_max_impl( v, n, min, max );
+}
+
+KERNEL void min_max( const float* v, size_t n, double& min, double& max )
+{
+  min_max_impl( v, n, min, max );
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+INLINE void map_to_cells_impl(
+  const T* v, size_t n,
+  bool log, double min, double max, int64_t cells, int64_t* out
+)
+{
+  if ( n == 0 ) return;
+  const double span = max - min;
+  const double c = cells;
+  // The cell is found in floating point so the whole loop can be vectorized;
+  // the conversion goes through 32 bits as there is no vector conversion to 64
+  // bits before AVX-512DQ.
+  const bool narrow = cells <= INT32_MAX;
+  auto to_cell = [&]( double x ) -> int64_t
+  {
+    const double t = (x - min) / span * c;
+    const double r = (t >= 0 && t <= c) ? std::min( t, c - 1 ) : -1.0;
+    return narrow ? int64_t( int32_t( r ) ) : int64_t( r );
+  };
+  if ( log ) {
+    double lo, hi;
+    min_max_impl( v, n, lo, hi );
+    if ( !(lo > 0) ) {
+      for ( size_t i = 0; i < n; i++ ) {
+        if ( !(v[ i ] > 0) ) {
+          out[ i ] = -1;
+        } else if ( !(span > 0) ) {
+          out[ i ] = 0;
+        } else {
+          out[ i ] = to_cell( std::log10( double( v[ i ] ) ) );
+        }
+      }
+      return;
+    }
+  }
+  if ( !(span > 0) ) {
+    std::fill( out, out + n, 0 );
+    return;
+  }
+  if ( log ) {
+    for ( size_t i = 0; i < n; i++ ) {
+      out[ i ] = to_cell( std::log10( double( v[ i ] ) ) );
+    }
+  } else {
+    for ( size_t i = 0; i < n; i++ ) {
+      out[ i ] = to_cell( double( v[ i ] ) );
+    }
+  }
+}
+
+KERNEL void map_to_cells(
+  const double* v, size_t n,
+  bool log, double min, double max, int64_t cells, int64_t* out
+)
+{
+  map_to_cells_impl( v, n, log, min, max, cells, out );
+}
+
+KERNEL void map_to_cells(
+  const float* v, size_t n,
+  bool log, double min, double max, int64_t cells, int64_t* out
+)
+{
+  map_to_cells_impl( v, n, log, min, max, cells, out );
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+INLINE void clip_codes_impl(
+  const T* v, size_t n,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+)
+{
+  for ( size_t i = 0; i < n; i++ ) {
+    const double x = v[ i ];
+    codes[ i ] |= ((x < lo) ? below : 0) | ((x > hi) ? above : 0);
+  }
+}
+
+KERNEL void clip_codes(
+  const double* v, size_t n,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+)
+{
+  clip_codes_impl( v, n, lo, hi, below, above, codes );
+}
+
+KERNEL void clip_codes(
+  const float* v, size_t n,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+)
+{
+  clip_codes_impl( v, n, lo, hi, below, above, codes );
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T >
+INLINE void stack_values_impl( const T* v, size_t n, double* sum )
+{
+  for ( size_t i = 0; i < n; i++ ) sum[ i ] += v[ i ];
+}
+
+KERNEL void stack_values( const double* v, size_t n, double* sum )
+{
+  stack_values_impl( v, n, sum );
+}
+
+KERNEL void stack_values( const float* v, size_t n, double* sum )
+{
+  stack_values_impl( v, n, sum );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
@@ -0,0 +1,64 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Element-wise kernels for the passes over all data points of a series. Where
+// the compiler supports it, each kernel is compiled for several instruction
+// sets and the best one for the CPU is selected when the program is loaded.
+// The values must not be skip or invalid values.
+
+// Find the minimum and maximum of n > 0 values.
+void min_max( const double* v, size_t n, double& min, double& max );
+void min_max( const float * v, size_t n, double& min, double& max );
+
+// Map n values to raster cells 0 to cells-1 evenly spaced between min and max,
+// where min and max are log10 values if log is set. A value outside min to max
+// or one which cannot be shown on a log scale is mapped to -1.
+void map_to_cells(
+  const double* v, size_t n,
+  bool log, double min, double max, int64_t cells, int64_t* out
+);
+void map_to_cells(
+  const float * v, size_t n,
+  bool log, double min, double max, int64_t cells, int64_t* out
+);
+
+// Set the given bits in the clip codes of n values that are below lo or above
+// hi respectively; the codes of two points tell if the line between them may
+// cross a rectangle.
+void clip_codes(
+  const double* v, size_t n,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+);
+void clip_codes(
+  const float * v, size_t n,
+  double lo, double hi, uint8_t below, uint8_t above, uint8_t* codes
+);
+
+// Add n values to the running totals of the series stacked below them, as for
+// StackedBar and StackedArea, leaving the new totals in sum.
+void stack_values( const double* v, size_t n, double* sum );
+void stack_values( const float * v, size_t n, double* sum );
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
@@ -0,0 +1,69 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#include <chartgen_text.h>
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t TextMetrics::Cells( std::string_view text )
+{
+  const uint8_t* p = reinterpret_cast< const uint8_t* >( text.data() );
+  const uint8_t* e = p + text.size();
+  size_t cells = 0;
+  while ( p < e ) {
+    // Runs of ASCII are by far the most common.
+    if ( *p < 0x80 ) {
+      cells += ascii_cells[ *p++ ];
+      continue;
+    }
+    int n =
+      ((*p & 0xE0) == 0xC0) ? 1 :
+      ((*p & 0xF0) == 0xE0) ? 2 :
+      ((*p & 0xF8) == 0xF0) ? 3 : -1;
+    if ( n < 0 || e - p <= n ) {
+      cells++;
+      p++;
+      continue;
+    }
+    uint32_t c = *p & (0x3F >> n);
+    bool ok = true;
+    for ( int i = 1; i <= n; i++ ) {
+      ok = ok && (p[ i ] & 0xC0) == 0x80;
+      c = (c << 6) | (p[ i ] & 0x3F);
+    }
+    if ( !ok ) {
+      cells++;
+      p++;
+      continue;
+    }
+    cells += Cells( c );
+    p += n + 1;
+  }
+  return cells;
+}
+
+//------------------------------------------------------------------------------
+
+double TextMetrics::Width( std::string_view text, double size, bool bold )
+{
+  double w = Cells( text ) * cell_width * size;
+  if ( bold && w > 0 ) w += bold_stroke * size;
+  return w;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
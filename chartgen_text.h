@@ -0,0 +1,115 @@
+//
+//  MIT No Attribution License
+//
+//  Copyright 2024, Soren Kragh
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a
+//  copy of this software and associated documentation files (the
+//  “Software”), to deal in the Software without restriction, including
+//  without limitation the rights to use, copy, modify, merge, publish,
+//  distribute, sublicense, and/or sell copies of the Software, and to
+//  permit persons to whom the Software is furnished to do so.
+//
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace chartgen {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Control characters take no space.
+constexpr std::array< uint8_t, 128 > text_ascii_cells( void )
+{
+  std::array< uint8_t, 128 > a{};
+  for ( size_t c = 0; c < a.size(); c++ ) {
+    a[ c ] = (c < 0x20 || c == 0x7F) ? 0 : 1;
+  }
+  return a;
+}
+
+// Estimated metrics of text in the default mono-spaced font of the charts, in
+// units of the font size. Combining and zero-width characters take no space,
+// while wide (mostly East Asian) characters take two cells.
+class TextMetrics
+{
+public:
+
+  // Size of the default font in points.
+  static constexpr double font_size = 14;
+
+  static constexpr double cell_width  = 0.6;
+  static constexpr double line_height = 1.2;
+  static constexpr double bold_stroke = 0.05;
+
+  // Number of cells taken by a code point (0, 1 or 2).
+  static constexpr uint8_t Cells( uint32_t c )
+  {
+    if ( c < 0x80 ) return ascii_cells[ c ];
+    size_t lo = 0;
+    size_t hi = ranges.size();
+    while ( lo < hi ) {
+      size_t m = (lo + hi) / 2;
+      if ( c > ranges[ m ].last ) {
+        lo = m + 1;
+      } else if ( c < ranges[ m ].first ) {
+        hi = m;
+      } else {
+        return ranges[ m ].cells;
+      }
+    }
+    return 1;
+  }
+
+  // Number of cells taken by UTF-8 text; malformed bytes count as one cell.
+  static size_t Cells( std::string_view text );
+
+  // Width of the text in the given font size. Bold glyphs have the same advance
+  // as regular ones in a mono-spaced font, but the bold stroke adds a little.
+  static double Width( std::string_view text, double size, bool bold = false );
+
+  static double Height( double size ) { return line_height * size; }
+
+private:
+
+  struct Range {
+    uint32_t first;
+    uint32_t last;
+    uint8_t  cells;
+  };
+
+  // Sorted, non-overlapping code point ranges not taking one cell.
+  static constexpr std::array< Range, 19 > ranges{ {
+    { 0x0080, 0x009F, 0 },
+    { 0x0300, 0x036F, 0 },
+    { 0x1100, 0x115F, 2 },
+    { 0x200B, 0x200F, 0 },
+    { 0x2028, 0x202E, 0 },
+    { 0x2060, 0x2064, 0 },
+    { 0x20D0, 0x20FF, 0 },
+    { 0x2E80, 0x303E, 2 },
+    { 0x3041, 0x33FF, 2 },
+    { 0x3400, 0x4DBF, 2 },
+    { 0x4E00, 0x9FFF, 2 },
+    { 0xA000, 0xA4CF, 2 },
+    { 0xAC00, 0xD7A3, 2 },
+    { 0xF900, 0xFAFF, 2 },
+    { 0xFE00, 0xFE0F, 0 },
+    { 0xFE30, 0xFE4F, 2 },
+    { 0xFF00, 0xFF60, 2 },
+    { 0xFFE0, 0xFFE6, 2 },
+    { 0x1F300, 0x1F64F, 2 },
+  } };
+
+  static constexpr std::array< uint8_t, 128 > ascii_cells =
+    text_ascii_cells();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+}
@@ -86,6 +86,10 @@ Series.Data :
 # Series.Type: XY
 # Series.New: Name of series
 # Series.Prune: 0.5
+# Series.Raster: On
+# Series.Precision: Float
+# Series.Clip: Ingest
+# Series.Columns: 1 7 42
 # Series.GlobalLegend: On
 # Series.LegendOutline: Off
 # Series.Axis: Y2
@@ -103,9 +107,13 @@ Series.Data :
 # Series.TagPos: Below
 # Series.TagSize: 0.8
 # Series.TagBox: On
+# Series.TagOverlap: Off
+# Series.TagFilter: TopN 5
 # Series.TagTextColor: black
 # Series.TagFillColor: lightyellow 0 0.3
 # Series.TagLineColor: black
+# Series.Contour: 0.5 1.0 1.5
+# Series.ContourGrid: 0 0 1 1
 # Series.Data:
 # MacroDef: MyMacro
 # MacroEnd: MyMacro
@@ -264,6 +264,11 @@ Axis.Y2.LogScale: On
 # the axis is placed. If both a primary and a secondary Y-axis is used, then the
 # primary Y-axis is always to the left, and the secondary Y-axis is always to
 # the right. The X-axis range is ignored if the chart has textual X-values.
+# Whenever a Range is given, data points of XY and Scatter series that cannot be
+# seen are left out of the SVG. A data point is taken to be visible if it lies
+# within a margin of 32 points of the chart area (enough for markers and lines
+# of normal size), or if it is the end of an XY line segment crossing it; very
+# large markers may therefore be cut off at the edge of the chart area.
 #Axis.X.Range: 0 100 90
 #Axis.Y.Range: -5 25
 
@@ -299,7 +304,9 @@ Axis.Y2.LogScale: On
 # the second optional number is the stride after that (default stride is 1).
 # When stacking charts (see New) sharing the same textual X-axis, a trick to
 # not show the categories for the stacked charts, is to set the TickSpacing
-# start position really high for all but the bottom chart.
+# start position really high for all but the bottom chart. For the X-axis the
+# TickSpacing may also be Auto, in which case a stride is chosen from the
+# estimated width of the widest text; useful for very many categories.
 #Axis.X.TickSpacing: 0 10
 
 # Turn grid lines on/off for major and minor ticks; may be On or Off. Unless
@@ -428,6 +435,10 @@ Axis.Y2.NumberUnit: Ω
 #                           that negative values (relative to Base) are stacked
 #                           separately, so mixing negative with positive in the
 #                           same series will likely look weird.
+#   Contour     Matrix      Contour plot. The Series.Data is a matrix of values
+#                           sampled on a regular grid (see Series.ContourGrid)
+#                           and iso-lines are drawn as XY plots, one series per
+#                           contour level (see Series.Contour).
 #-------------------------------------------------------------------------------
 #
 # Since the X-values are true numbers for XY and Scatter types, these types
@@ -468,6 +479,44 @@ Series.New: Name of series
 # etc.
 #Series.Prune: 0.3
 
+# Reduce the series data to the resolution of the chart area before any other
+# processing; may be On or Off, default is Off. The chart area is regarded as a
+# raster of one point sized cells (see ChartArea). For XY plots only the first,
+# last, lowest, and highest data points of each run of data points falling in
+# the same raster column are kept, and for Scatter plots only one data point is
+# kept per occupied raster cell. The size of the SVG thereby depends on the
+# chart area rather than on the number of data points, which makes this useful
+# for very dense series where pruning alone is not enough. Tags and point
+# markers of removed data points are lost. Applies to XY and Scatter plots only.
+# This attribute applies to the current series and all subsequent series, or
+# until it is redefined.
+#Series.Raster: On
+
+# Precision used to hold the data points of the series while processing; may be
+# Double or Float, default is Double. Float halves the memory needed for very
+# large series and is plenty for e.g. sensor data with a handful of significant
+# digits, but values beyond approximately 3.4e38 are then not allowed. This
+# attribute applies to the current series and all subsequent series, or until
+# it is redefined.
+#Series.Precision: Float
+
+# Drop the data points which cannot be seen already while the data is read; may
+# be Ingest or Off, default is Off. The data points of XY and Scatter series are
+# always reduced to those that may be seen within any Axis.*.Range, but with
+# Ingest the data points outside are not even stored, so the memory needed
+# depends on the range rather than on the full data set. Only the ranges given
+# before Series.Data are applied while reading. This attribute applies to the
+# current series and all subsequent series, or until it is redefined.
+#Series.Clip: Ingest
+
+# Select which Y-value columns of the following Series.Data are used; may be a
+# list of column numbers or All, default is All. The first Y-value column is
+# number 1. One series is used per selected column, in the order given, and the
+# other columns are skipped without being read as numbers. This is useful for
+# wide data tables where only a few columns are of interest. This attribute
+# applies to all subsequent Series.Data, or until it is redefined.
+#Series.Columns: 1 7 42
+
 # Set the series legend to be global; may be On or Off, default is Off. Global
 # legends are relevant when multiple charts are organized in a grid, in which
 # case the legends are shown outside the charts. Global legends may be shared,
@@ -550,6 +599,17 @@ Series.Base: 0
 # applies to the current series only.
 #Series.FillColor: None
 
+# The contour levels used for Contour type plots; default is ten levels evenly
+# spread between the smallest and the largest value of the matrix. This
+# attribute applies to all subsequent Contour plots, or until it is redefined.
+#Series.Contour: 0.5 1.0 1.5
+
+# The X- and Y-value of the first matrix value, followed by the X- and Y-spacing
+# between matrix columns and rows respectively, used for Contour type plots;
+# default is 0 0 1 1. This attribute applies to all subsequent Contour plots, or
+# until it is redefined.
+#Series.ContourGrid: 0 0 1 1
+
 # Enable tagging of data points, that is, showing the data values near the data
 # points. This will quickly become cluttered, so should only be used for
 # relatively simple charts. For XY and Scatter plot, both the X- and the Y-value
@@ -567,6 +627,21 @@ Series.Base: 0
 # Show the tag in a small box; may be On or Off.
 #Series.TagBox: On
 
+# Allow tags to overlap; may be On or Off, default is On. If Off, the tags of an
+# XY or Scatter series are thinned such that a tag is left out if it would
+# overlap the tag of an earlier data point. This makes it possible to enable
+# tagging for series with many data points; the tag sizes are estimates, so
+# some overlap may still occur.
+#Series.TagOverlap: Off
+
+# Select the data points to tag; may be All (the default), Extrema (the data
+# points with the lowest and the highest Y-value), TopN followed by a count (the
+# data points with the highest Y-values), Every followed by a count K (every Kth
+# data point, starting with the first), or Last (the last data point). The
+# selection is made among the data points left after any range clipping and
+# data reduction. This makes tags usable for long series.
+#Series.TagFilter: TopN 5
+
 # Tag text color, the fill color of the tag box (if any), and the color of the
 # line around the tag box (if any); they act as persistent modifiers to the
 # current Style. These attributes apply to the current series and all subsequent
@@ -594,6 +669,20 @@ Series.Data:
         71      4.3
         97      14
 
+# For Contour type plots the data is instead a matrix of values, one matrix row
+# per line; all rows must have the same number of values. A dash (-) or an
+# exclamation mark (!) denotes a missing value, and no iso-lines are drawn in
+# the grid cells next to it. One series is used for each contour level; empty
+# series created beforehand with type Contour are used first and anonymous ones
+# are automatically created as needed, named after the contour level.
+#Series.Type: Contour
+#Series.ContourGrid: 0 0 0.5 0.5
+#Series.Contour: 10 20 30
+#Series.Data:
+#       12      17      23      29
+#       14      21      28      33
+#       19      26      31      38
+
 # Several series sharing the same X-values can be specified in one go; series
 # using a text string as the X-value (everything but XY and Scatter types)
 # should use this way of specifying the series data. Use double-quotes if the